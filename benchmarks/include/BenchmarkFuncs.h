@@ -26,6 +26,12 @@ struct XorShift32
     }
 };
 
+struct LiveBlock
+{
+    std::byte* p;
+    uint32_t size;
+};
+
 struct BenchmarkConfig
 {
     int iterations = 5'000'000;
@@ -38,7 +44,7 @@ struct BenchmarkConfig
 template<typename TAllocator>
 double benchmark_random(TAllocator& alloc, const BenchmarkConfig& cfg)
 {
-    std::vector<std::byte*> live;
+    std::vector<LiveBlock> live;
     live.reserve(cfg.maxLiveAllocs);
 
     XorShift32 rng;
@@ -56,19 +62,72 @@ double benchmark_random(TAllocator& alloc, const BenchmarkConfig& cfg)
         {
             int size = cfg.minSize + rng.range(cfg.maxSize - cfg.minSize + 1);
             std::byte* p = alloc.allocate(size);
-            live.push_back(p);
+            live.push_back({ p, (uint32_t)size });
         }
         else
         {
             int idx = rng.range((uint32_t)live.size());
-            alloc.deallocate(live[idx], 1);
+            alloc.deallocate(live[idx].p, live[idx].size);
+            live[idx] = live.back();
+            live.pop_back();
+        }
+    }
+
+    for (LiveBlock& block : live)
+        alloc.deallocate(block.p, block.size);
+
+    auto t1 = Clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+template<typename TAllocator>
+double benchmark_growth(TAllocator& alloc, const BenchmarkConfig& cfg, uint64_t& outCopies)
+{
+    std::vector<LiveBlock> live;
+    live.reserve(cfg.maxLiveAllocs);
+
+    XorShift32 rng;
+    outCopies = 0;
+
+    auto t0 = Clock::now();
+
+    for (int i = 0; i < cfg.iterations; ++i)
+    {
+        bool doAlloc =
+            live.empty() ||
+            (live.size() < cfg.maxLiveAllocs &&
+                rng.next() < cfg.allocChance * UINT32_MAX);
+
+        if (doAlloc)
+        {
+            uint32_t size = cfg.minSize + rng.range(cfg.minSize);
+            live.push_back({ alloc.allocate(size), size });
+            continue;
+        }
+
+        int idx = rng.range((uint32_t)live.size());
+        LiveBlock& buffer = live[idx];
+
+        if (buffer.size < (uint32_t)cfg.maxSize)
+        {
+            // Append-like growth, as string builders and vectors do
+            uint32_t size = buffer.size + 1 + rng.range(buffer.size / 2 + 1);
+            std::byte* p = alloc.reallocate(buffer.p, buffer.size, size);
+            if (p != buffer.p)
+                outCopies++;
+
+            buffer = { p, size };
+        }
+        else
+        {
+            alloc.deallocate(buffer.p, buffer.size);
             live[idx] = live.back();
             live.pop_back();
         }
     }
 
-    for (std::byte* p : live)
-        alloc.deallocate(p, 1);
+    for (LiveBlock& buffer : live)
+        alloc.deallocate(buffer.p, buffer.size);
 
     auto t1 = Clock::now();
     return std::chrono::duration<double, std::milli>(t1 - t0).count();
@@ -1,8 +1,20 @@
 #include <crtdbg.h>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
 
 #include <MemoryAllocatorT.h>
+#include <SharedHeap.h>
+#include <SnapshotHeap.h>
 #include "BenchmarkFuncs.h"
 
 template <typename T>
@@ -35,6 +47,13 @@ struct StdAllocator {
         ::operator delete(p);
     }
 
+    T* reallocate(T* p, std::size_t oldN, std::size_t n) {
+        T* np = allocate(n);
+        memcpy(np, p, std::min(oldN, n) * sizeof(T));
+        deallocate(p, oldN);
+        return np;
+    }
+
     template <typename U>
     struct rebind {
         using other = StdAllocator<U>;
@@ -49,6 +68,17 @@ void runRawTest(const char* name, const BenchmarkConfig& cfg, StdAllocator<std::
     printf("============================\n\n");
 }
 
+void runGrowthTest(const char* name, const BenchmarkConfig& cfg, StdAllocator<std::byte>& stdAllocator, MemoryAllocator::MemoryAllocatorT<std::byte>& customAllocator)
+{
+    uint64_t copies = 0;
+    printf("======== %s ========\n", name);
+    double stdTime = benchmark_growth(stdAllocator, cfg, copies);
+    printf("StdAllocator:    %lf ms\tcopies: %llu\n", stdTime, (unsigned long long)copies);
+    double customTime = benchmark_growth(customAllocator, cfg, copies);
+    printf("CustomAllocator: %lf ms\tcopies: %llu\n", customTime, (unsigned long long)copies);
+    printf("============================\n\n");
+}
+
 template<typename T>
 void runVectorTest(const char* name, const BenchmarkConfig& cfg)
 {
@@ -74,8 +104,387 @@ void runMapTest(const char* name, const BenchmarkConfig& cfg)
     printf("============================\n\n");
 }
 
-int main()
+static void* const SHARED_HEAP_BASE = (void*)0x300000000000ull;
+static constexpr uint64 SHARED_HEAP_CAPACITY = 512ull * 1024 * 1024;
+static const char* SHARED_CONSUMER_ARG = "--shared-consumer";
+
+// Single producer, single consumer ring of offsets, placed in the shared heap
+struct SharedQueue
+{
+    static constexpr uint32_t CAPACITY = 64;
+
+    std::atomic<uint64_t> head;
+    char headPad[56];
+    std::atomic<uint64_t> tail;
+    char tailPad[56];
+    std::atomic<uint32_t> consumerReady;
+    bool handoff;
+    uint32_t count;
+    uint32_t size;
+    uint64_t checksum;
+    uint64_t slots[CAPACITY];
+    // Copy mode only: fixed buffers the messages are copied through, like a pipe
+    uint64_t buffers[CAPACITY];
+};
+
+static uint64_t sumMessage(const uint8_t* p, uint32_t size)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < size; i += sizeof(uint64_t))
+        sum += *(const uint64_t*)(p + i);
+    return sum;
+}
+
+// Child process side: reads every message and releases the slot
+int runSharedHeapConsumer(const char* name)
+{
+    SharedHeap::SharedHeap heap;
+    if (!heap.open(name, SHARED_HEAP_CAPACITY, SHARED_HEAP_BASE))
+        return 1;
+
+    auto* queue = (SharedQueue*)heap.getRoot(0);
+    std::vector<uint8_t> message(queue->size);
+    queue->consumerReady.store(1, std::memory_order_release);
+
+    uint64_t checksum = 0;
+    for (uint64_t tail = 0; tail < queue->count; tail++) {
+        while (queue->head.load(std::memory_order_acquire) == tail)
+            std::this_thread::yield();
+
+        uint32_t slot = tail % SharedQueue::CAPACITY;
+        if (queue->handoff) {
+            // The producer's block is read in place and freed by this process
+            auto* p = (uint8_t*)heap.fromOffset(queue->slots[slot]);
+            checksum += sumMessage(p, queue->size);
+            heap.free(p);
+        }
+        else {
+            memcpy(message.data(), heap.fromOffset(queue->buffers[slot]), queue->size);
+            checksum += sumMessage(message.data(), queue->size);
+        }
+
+        queue->tail.store(tail + 1, std::memory_order_release);
+    }
+
+    queue->checksum = checksum;
+    return 0;
+}
+
+// Time the consumer process gets to open the heap
+static constexpr auto CONSUMER_START_TIMEOUT = std::chrono::seconds(10);
+
+// Yields until ready() holds. Fails when the consumer process exits first or the deadline passes
+template <typename Ready>
+static bool waitForConsumer(HANDLE process, Ready ready, Clock::time_point deadline = Clock::time_point::max())
+{
+    for (uint32_t spins = 1; !ready(); spins++) {
+        // A process handle check is a syscall, it is not made on every spin
+        if (spins % 1024 == 0 && (WaitForSingleObject(process, 0) != WAIT_TIMEOUT || Clock::now() > deadline))
+            return false;
+
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+// Parent process side: builds count messages and hands them to a consumer process
+double benchmark_shared_heap(const char* exePath, bool handoff, uint32_t count, uint32_t size)
+{
+    std::string name = "CompositeMemoryAllocatorBenchmark_" + std::to_string(GetCurrentProcessId());
+    SharedHeap::SharedHeap heap;
+    if (!heap.open(name.c_str(), SHARED_HEAP_CAPACITY, SHARED_HEAP_BASE))
+        return -1.0;
+
+    auto* queue = (SharedQueue*)heap.alloc(sizeof(SharedQueue));
+    memset(queue, 0, sizeof(SharedQueue));
+    queue->handoff = handoff;
+    queue->count = count;
+    queue->size = size;
+    if (!handoff) {
+        for (uint64_t& buffer : queue->buffers)
+            buffer = heap.toOffset(heap.alloc(size));
+    }
+    heap.setRoot(0, queue);
+
+    std::string cmdLine = std::string("\"") + exePath + "\" " + SHARED_CONSUMER_ARG + " " + name;
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    PROCESS_INFORMATION pi = {};
+    if (!CreateProcessA(nullptr, cmdLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &si, &pi))
+        return -1.0;
+
+    auto stopConsumer = [&pi](const char* error) {
+        fprintf(stderr, "Shared heap consumer %s\n", error);
+        TerminateProcess(pi.hProcess, 1);
+        WaitForSingleObject(pi.hProcess, INFINITE);
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+        return -1.0;
+    };
+
+    auto ready = [queue] { return queue->consumerReady.load(std::memory_order_acquire) != 0; };
+    if (!waitForConsumer(pi.hProcess, ready, Clock::now() + CONSUMER_START_TIMEOUT))
+        return stopConsumer("exited or timed out before opening the heap");
+
+    std::vector<uint8_t> message(size);
+    uint64_t checksum = 0;
+
+    auto t0 = Clock::now();
+    for (uint64_t head = 0; head < count; head++) {
+        auto hasRoom = [queue, head] { return head - queue->tail.load(std::memory_order_acquire) < SharedQueue::CAPACITY; };
+        if (!waitForConsumer(pi.hProcess, hasRoom))
+            return stopConsumer("exited before reading every message");
+
+        uint32_t slot = head % SharedQueue::CAPACITY;
+        if (handoff) {
+            // Built in place, only the offset crosses the process boundary
+            auto* p = (uint8_t*)heap.alloc(size);
+            memset(p, (int)head, size);
+            checksum += sumMessage(p, size);
+            queue->slots[slot] = heap.toOffset(p);
+        }
+        else {
+            memset(message.data(), (int)head, size);
+            checksum += sumMessage(message.data(), size);
+            memcpy(heap.fromOffset(queue->buffers[slot]), message.data(), size);
+        }
+
+        queue->head.store(head + 1, std::memory_order_release);
+    }
+
+    WaitForSingleObject(pi.hProcess, INFINITE);
+    auto t1 = Clock::now();
+
+    DWORD exitCode = 1;
+    GetExitCodeProcess(pi.hProcess, &exitCode);
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+
+    if (exitCode != 0 || queue->checksum != checksum)
+        return -1.0;
+
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+void runSharedHeapTest(const char* name, const char* exePath, uint32_t count, uint32_t size)
+{
+    double gb = (double)count * size / (1024.0 * 1024.0 * 1024.0);
+    printf("======== %s ========\n", name);
+    double copyTime = benchmark_shared_heap(exePath, false, count, size);
+    double handoffTime = copyTime < 0 ? -1.0 : benchmark_shared_heap(exePath, true, count, size);
+    if (handoffTime < 0) {
+        printf("Failed, see the error above\n");
+        printf("============================\n\n");
+        return;
+    }
+
+    printf("CopyThroughBuffer: %lf ms\t%lf GB/s\n", copyTime, gb / (copyTime / 1000.0));
+    printf("SharedHeapOffset:  %lf ms\t%lf GB/s\n", handoffTime, gb / (handoffTime / 1000.0));
+    printf("============================\n\n");
+}
+
+enum class Placement { Alloc, Near, Colocated };
+
+// Builds listCount interleaved lists over a heap with holes left by churn, then times traversal
+double benchmark_locality(Placement placement, uint32_t listCount, uint32_t nodeCount)
 {
+    struct Node {
+        Node* next;
+        uint64_t payload[5];
+    };
+
+    CompositeMemoryAllocator::CompositeMemoryAllocator allocator;
+    allocator.init();
+
+    XorShift32 rng;
+    std::vector<void*> churn(4 * nodeCount);
+    for (void*& p : churn)
+        p = allocator.alloc(sizeof(Node));
+    for (uint32_t i = (uint32_t)churn.size() - 1; i > 0; i--)
+        std::swap(churn[i], churn[rng.range(i + 1)]);
+    for (uint32_t i = 0; i < churn.size() / 2; i++) {
+        allocator.free(churn[i], sizeof(Node));
+        churn[i] = nullptr;
+    }
+
+    std::vector<Node*> heads(listCount, nullptr), tails(listCount, nullptr);
+    for (uint32_t i = 0; i < nodeCount; i++) {
+        uint32_t list = i % listCount;
+        Node* tail = tails[list];
+        void* p = placement == Placement::Near ? allocator.allocNear(sizeof(Node), tail)
+                : placement == Placement::Colocated ? allocator.allocColocated(sizeof(Node), list)
+                : allocator.alloc(sizeof(Node));
+
+        auto* node = new (p) Node{ nullptr, { i } };
+        (tail ? tail->next : heads[list]) = node;
+        tails[list] = node;
+    }
+
+    uint64_t checksum = 0;
+    auto t0 = Clock::now();
+    for (int pass = 0; pass < 20; pass++) {
+        for (Node* node : heads) {
+            for (; node; node = node->next)
+                checksum += node->payload[0];
+        }
+    }
+    auto t1 = Clock::now();
+
+    for (Node* node : heads) {
+        while (node) {
+            Node* next = node->next;
+            allocator.free(node, sizeof(Node));
+            node = next;
+        }
+    }
+    for (void* p : churn) {
+        if (p) allocator.free(p, sizeof(Node));
+    }
+    allocator.destroy();
+
+    if (checksum == 0)
+        printf("checksum: 0\n");
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+void runLocalityTest(const char* name, uint32_t listCount, uint32_t nodeCount)
+{
+    printf("======== %s ========\n", name);
+    printf("Alloc:           %lf ms\n", benchmark_locality(Placement::Alloc, listCount, nodeCount));
+    printf("AllocNear:       %lf ms\n", benchmark_locality(Placement::Near, listCount, nodeCount));
+    printf("AllocColocated:  %lf ms\n", benchmark_locality(Placement::Colocated, listCount, nodeCount));
+    printf("============================\n\n");
+}
+
+static double getWorkingSetMB()
+{
+    PROCESS_MEMORY_COUNTERS counters = {};
+    counters.cb = sizeof(counters);
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return (double)counters.WorkingSetSize / (1024.0 * 1024.0);
+}
+
+// Snapshot cost and the memory the live heap duplicates as it keeps writing
+void runSnapshotTest(const char* name, uint32_t blockCount, uint32_t blockSize)
+{
+    static void* const SNAPSHOT_HEAP_BASE = (void*)0x310000000000ull;
+
+    printf("======== %s ========\n", name);
+
+    SnapshotHeap::SnapshotHeap heap;
+    if (!heap.open(2ull * blockCount * blockSize + 64ull * 1024 * 1024, SNAPSHOT_HEAP_BASE)) {
+        printf("Failed to open the heap\n");
+        return;
+    }
+
+    auto& allocator = heap.allocator();
+    auto** blocks = (uint8_t**)allocator.alloc(blockCount * sizeof(uint8_t*));
+    for (uint32_t i = 0; i < blockCount; i++) {
+        blocks[i] = (uint8_t*)allocator.alloc(blockSize);
+        memset(blocks[i], (int)i, blockSize);
+    }
+    heap.setRoot(0, blocks);
+
+    auto t0 = Clock::now();
+    heap.takeSnapshot();
+    auto t1 = Clock::now();
+    printf("Snapshot:        %lf ms\n", std::chrono::duration<double, std::milli>(t1 - t0).count());
+
+    // Read the whole snapshot once, so only copies add to the working set afterwards
+    uint64_t checksum = 0;
+    auto* snapshotBlocks = (uint8_t* const*)heap.getSnapshotRoot(0);
+    for (uint32_t i = 0; i < blockCount; i++)
+        checksum += sumMessage(heap.inSnapshot(snapshotBlocks[i]), blockSize);
+
+    double baseline = getWorkingSetMB();
+    uint32_t written = 0;
+    for (uint32_t percent : { 10u, 25u, 50u, 100u }) {
+        for (; written < (uint64_t)blockCount * percent / 100; written++)
+            memset(blocks[written], 0xFF, blockSize);
+        printf("Written %3u%%:    +%lf MB\n", percent, getWorkingSetMB() - baseline);
+    }
+
+    t0 = Clock::now();
+    bool released = heap.releaseSnapshot();
+    t1 = Clock::now();
+    if (!released)
+        printf("Release failed\n");
+    printf("Release:         %lf ms\tchecksum: %llu\n", std::chrono::duration<double, std::milli>(t1 - t0).count(),
+           (unsigned long long)checksum);
+    printf("============================\n\n");
+}
+
+// Churn speed, then the working set after the load drops, churns on and the heap is trimmed
+void runReusePolicyTest(const char* name, const BenchmarkConfig& cfg)
+{
+    static const std::pair<const char*, FixedSizeAllocator::ReusePolicy> POLICIES[] = {
+        { "Lifo:           ", FixedSizeAllocator::ReusePolicy::Lifo },
+        { "AddressOrdered: ", FixedSizeAllocator::ReusePolicy::AddressOrdered },
+        { "FullestPage:    ", FixedSizeAllocator::ReusePolicy::FullestPage },
+    };
+
+    printf("======== %s ========\n", name);
+    for (auto& [label, policy] : POLICIES) {
+        double baseline = getWorkingSetMB();
+
+        CompositeMemoryAllocator::CompositeMemoryAllocator allocator;
+        allocator.init(nullptr, policy);
+
+        std::vector<LiveBlock> live;
+        live.reserve(cfg.maxLiveAllocs);
+        XorShift32 rng;
+
+        auto churn = [&](int iterations, size_t maxLive) {
+            for (int i = 0; i < iterations; ++i) {
+                bool doAlloc = live.empty() ||
+                    (live.size() < maxLive && rng.next() < cfg.allocChance * UINT32_MAX);
+
+                if (doAlloc) {
+                    uint32_t size = cfg.minSize + rng.range(cfg.maxSize - cfg.minSize + 1);
+                    live.push_back({ (std::byte*)allocator.alloc(size), size });
+                    memset(live.back().p, 0, size);
+                }
+                else {
+                    uint32_t idx = rng.range((uint32_t)live.size());
+                    allocator.free(live[idx].p, live[idx].size);
+                    live[idx] = live.back();
+                    live.pop_back();
+                }
+            }
+        };
+
+        auto t0 = Clock::now();
+        churn(cfg.iterations, cfg.maxLiveAllocs);
+        auto t1 = Clock::now();
+        double churnSet = getWorkingSetMB() - baseline;
+
+        // The load drops to a tenth and keeps churning: sparse pages empty out only
+        // when new blocks go elsewhere
+        while (live.size() > cfg.maxLiveAllocs / 10) {
+            uint32_t idx = rng.range((uint32_t)live.size());
+            allocator.free(live[idx].p, live[idx].size);
+            live[idx] = live.back();
+            live.pop_back();
+        }
+        churn(cfg.iterations, cfg.maxLiveAllocs / 10);
+        allocator.trim();
+        double trimmedSet = getWorkingSetMB() - baseline;
+
+        printf("%s%lf ms\tafter churn: %.1lf MB\tafter trim: %.1lf MB\n",
+               label, std::chrono::duration<double, std::milli>(t1 - t0).count(), churnSet, trimmedSet);
+
+        for (LiveBlock& block : live)
+            allocator.free(block.p, block.size);
+        allocator.destroy();
+    }
+    printf("============================\n\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && strcmp(argv[1], SHARED_CONSUMER_ARG) == 0)
+        return runSharedHeapConsumer(argv[2]);
+
     StdAllocator<std::byte> stdAllocator;
     MemoryAllocator::MemoryAllocatorT<std::byte> customAllocator;
 
@@ -134,6 +543,39 @@ int main()
         runRawTest("MixedAlloc", cfg, stdAllocator, customAllocator);
     }
 
+    {
+        BenchmarkConfig cfg = {};
+        cfg.iterations = 1'000'000;
+        cfg.maxLiveAllocs = 1000;
+        cfg.allocChance = 0.1f;
+        cfg.minSize = 16;
+        cfg.maxSize = 64 * 1024;
+
+        runGrowthTest("SmallBufferGrowth", cfg, stdAllocator, customAllocator);
+    }
+
+    {
+        BenchmarkConfig cfg = {};
+        cfg.iterations = 100'000;
+        cfg.maxLiveAllocs = 100;
+        cfg.allocChance = 0.05f;
+        cfg.minSize = 1024;
+        cfg.maxSize = 4 * 1024 * 1024;
+
+        runGrowthTest("LargeBufferGrowth", cfg, stdAllocator, customAllocator);
+    }
+
+    {
+        BenchmarkConfig cfg = {};
+        cfg.iterations = 1'000;
+        cfg.maxLiveAllocs = 4;
+        cfg.allocChance = 0.05f;
+        cfg.minSize = 17 * 1024 * 1024;
+        cfg.maxSize = 512 * 1024 * 1024;
+
+        runGrowthTest("HugeBufferGrowth", cfg, stdAllocator, customAllocator);
+    }
+
     {
         BenchmarkConfig cfg = {};
         cfg.iterations = 10'000'000;
@@ -167,5 +609,25 @@ int main()
         runMapTest("LargeMap", cfg);
     }
 
+    runSharedHeapTest("SmallMessageIPC", argv[0], 500'000, 4 * 1024);
+    runSharedHeapTest("MediumMessageIPC", argv[0], 32'000, 64 * 1024);
+    runSharedHeapTest("LargeMessageIPC", argv[0], 2'000, 1024 * 1024);
+
+    runSnapshotTest("HeapSnapshot", 256 * 1024, 1024);
+
+    runLocalityTest("FewListsTraversal", 16, 200'000);
+    runLocalityTest("ManyListsTraversal", 128, 200'000);
+
+    {
+        BenchmarkConfig cfg = {};
+        cfg.iterations = 2'000'000;
+        cfg.maxLiveAllocs = 200'000;
+        cfg.allocChance = 0.6f;
+        cfg.minSize = 16;
+        cfg.maxSize = 512;
+
+        runReusePolicyTest("FSAReusePolicy", cfg);
+    }
+
 	return 0;
 }
\ No newline at end of file
@@ -182,4 +182,89 @@ namespace CoalesceAllocator {
 
         allocator.destroy();
     }
-}
\ No newline at end of file
+
+    TEST(CoalesceAllocator, ResizeGrowIntoFreeNeighbor)
+    {
+        CoalesceAllocator allocator = CoalesceAllocator();
+        allocator.init();
+
+        void* p1 = allocator.alloc(1024);
+        void* p2 = allocator.alloc(1024);
+        allocator.free(p2);
+
+        EXPECT_TRUE(allocator.resize(p1, 8 * 1024));
+        EXPECT_GE(CoalesceAllocator::getAllocSize(p1), 8 * 1024);
+
+        allocator.free(p1);
+        allocator.destroy();
+    }
+
+    TEST(CoalesceAllocator, ResizeBlockedByAllocatedNeighbor)
+    {
+        CoalesceAllocator allocator = CoalesceAllocator();
+        allocator.init();
+
+        void* p1 = allocator.alloc(1024);
+        void* p2 = allocator.alloc(1024);
+
+        EXPECT_FALSE(allocator.resize(p1, 2048));
+        EXPECT_GE(CoalesceAllocator::getAllocSize(p1), 1024);
+
+        allocator.free(p2);
+        allocator.free(p1);
+        allocator.destroy();
+    }
+
+    TEST(CoalesceAllocator, ResizeShrinkReleasesTail)
+    {
+        CoalesceAllocator allocator = CoalesceAllocator();
+        allocator.init();
+
+        void* p1 = allocator.alloc(8 * 1024);
+        void* p2 = allocator.alloc(1024);
+
+        EXPECT_TRUE(allocator.resize(p1, 1024));
+        EXPECT_GE(CoalesceAllocator::getAllocSize(p1), 1024);
+
+        void* p3 = allocator.alloc(4096);
+        EXPECT_TRUE(p3 > p1 && p3 < p2);
+
+        allocator.free(p3);
+        allocator.free(p2);
+        allocator.free(p1);
+        allocator.destroy();
+    }
+
+    TEST(CoalesceAllocator, AllocAlignedKeepsPrefix)
+    {
+        CoalesceAllocator allocator = CoalesceAllocator();
+        allocator.init();
+
+        void* p1 = allocator.alloc(100);
+        void* p2 = allocator.allocAligned(1000, 4096);
+        EXPECT_EQ((uintptr_t)p2 % 4096, 0);
+
+        // The gap before the aligned block is reused
+        void* p3 = allocator.alloc(200);
+        EXPECT_TRUE(p3 > p1 && p3 < p2);
+
+        allocator.free(p2);
+        allocator.free(p3);
+        allocator.free(p1);
+        allocator.destroy();
+    }
+
+    TEST(CoalesceAllocator, UnfittableAlignmentAddsNoPage)
+    {
+        CoalesceAllocator allocator = CoalesceAllocator();
+        allocator.init();
+
+        for (int i = 0; i < 3; i++)
+            EXPECT_EQ(allocator.allocAligned(PAGE_SIZE - 4096, PAGE_SIZE / 2), nullptr);
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+        EXPECT_EQ(allocator.getStat().pagesCount, 1u);
+#endif
+
+        allocator.destroy();
+    }
+}
@@ -1,6 +1,8 @@
 #include "lib/googletest/include/gtest/gtest.h"
 
-#include <CompositeMemoryAllocator.h>
+#include <CompositeMemoryAllocatorImpl.h>
+
+#include <algorithm>
 
 namespace CompositeMemoryAllocator {
     void AllocateRange(CompositeMemoryAllocator &allocator, std::vector<void*> &plist, int count, uint32 minSize, uint32 maxSize) {
@@ -79,4 +81,526 @@ namespace CompositeMemoryAllocator {
 
         allocator.destroy();
     }
-}
\ No newline at end of file
+
+    TEST(CompositeMemoryAllocator, ReallocFSAInPlace) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        void* p = allocator.alloc(20);
+        memset(p, 0xab, 20);
+        EXPECT_EQ(allocator.realloc(p, 32), p);
+        EXPECT_EQ(allocator.realloc(p, 17), p);
+
+        void* np = allocator.realloc(p, 100);
+        EXPECT_NE(np, p);
+        for (int i = 0; i < 20; i++)
+            EXPECT_EQ(((uint8*)np)[i], 0xab);
+
+        allocator.free(np);
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, ReallocCoalesceInPlace) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        void* p = allocator.alloc(1024);
+        memset(p, 0xcd, 1024);
+        EXPECT_EQ(allocator.realloc(p, 64 * 1024), p);
+        EXPECT_EQ(allocator.realloc(p, 2048), p);
+        for (int i = 0; i < 1024; i++)
+            EXPECT_EQ(((uint8*)p)[i], 0xcd);
+
+        // The released tail is reused by the next allocation
+        void* next = allocator.alloc(4096);
+        EXPECT_EQ((uint8*)next, (uint8*)p + allocator.usableSize(p) + CoalesceAllocator::CoalesceAllocator::getBlockEndSize() +
+            CoalesceAllocator::CoalesceAllocator::getBlockStartSize());
+
+        allocator.free(next);
+        allocator.free(p);
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, ReallocAcrossTiers) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        void* p = allocator.alloc(16);
+        memset(p, 0x5a, 16);
+        p = allocator.realloc(p, 4096);
+        p = allocator.realloc(p, 20 * 1024 * 1024);
+        p = allocator.realloc(p, 1024);
+        p = allocator.realloc(p, 16);
+        for (int i = 0; i < 16; i++)
+            EXPECT_EQ(((uint8*)p)[i], 0x5a);
+
+        EXPECT_EQ(allocator.realloc(p, 0), nullptr);
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, ReallocVirtualAllocInPlace) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        auto* p = (uint8*)allocator.alloc(20 * 1024 * 1024);
+        p[0] = 1;
+        p[20 * 1024 * 1024 - 1] = 2;
+
+        EXPECT_EQ(allocator.realloc(p, 36 * 1024 * 1024), p);
+        p[36 * 1024 * 1024 - 1] = 3;
+        EXPECT_EQ(allocator.realloc(p, 17 * 1024 * 1024), p);
+        EXPECT_EQ(allocator.realloc(p, 30 * 1024 * 1024), p);
+
+        auto* np = (uint8*)allocator.realloc(p, 100 * 1024 * 1024);
+        EXPECT_NE(np, p);
+        EXPECT_EQ(np[0], 1);
+        np[100 * 1024 * 1024 - 1] = 4;
+
+        allocator.free(np);
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, GrowableNeverMoves) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        auto* p = (uint8*)allocator.allocGrowable(256 * 1024 * 1024);
+        EXPECT_TRUE(p != nullptr);
+
+        EXPECT_TRUE(allocator.grow(p, 1024 * 1024));
+        p[1024 * 1024 - 1] = 1;
+        EXPECT_TRUE(allocator.grow(p, 200 * 1024 * 1024));
+        p[200 * 1024 * 1024 - 1] = 2;
+        EXPECT_EQ(p[1024 * 1024 - 1], 1);
+
+        EXPECT_FALSE(allocator.grow(p, 512 * 1024 * 1024));
+        EXPECT_EQ(p[200 * 1024 * 1024 - 1], 2);
+
+        allocator.free(p);
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, UsableSize) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        EXPECT_EQ(allocator.goodSize(1), 16);
+        EXPECT_EQ(allocator.goodSize(257), 512);
+        EXPECT_GE(allocator.goodSize(4000), 4000);
+        EXPECT_LT(allocator.goodSize(4000), 4000 + DEFAULT_ALIGNMENT);
+        EXPECT_GE(allocator.goodSize(20 * 1024 * 1024 + 1), 20 * 1024 * 1024 + 1);
+
+        void* p1 = allocator.alloc(257);
+        void* p2 = allocator.alloc(4000);
+        void* p3 = allocator.alloc(20 * 1024 * 1024 + 1);
+        EXPECT_EQ(allocator.usableSize(p1), 512);
+        EXPECT_GE(allocator.usableSize(p2), 4000);
+        EXPECT_EQ(allocator.usableSize(p3), allocator.goodSize(20 * 1024 * 1024 + 1));
+
+        // An over-aligned block may sit in a bigger tier than its size selects
+        void* a1 = allocator.allocAligned(64, 512);
+        void* a2 = allocator.allocAligned(20 * 1024 * 1024 + 1, 64 * 1024);
+        EXPECT_EQ(allocator.goodSizeAligned(64, 512), 512);
+        EXPECT_EQ(allocator.usableSize(a1), allocator.goodSizeAligned(64, 512));
+        EXPECT_EQ(allocator.usableSize(a2), allocator.goodSizeAligned(20 * 1024 * 1024 + 1, 64 * 1024));
+        EXPECT_EQ(allocator.goodSizeAligned(100, DEFAULT_ALIGNMENT), allocator.goodSize(100));
+        allocator.free(a1);
+        allocator.free(a2);
+
+        // The spare bytes survive a move to another tier
+        ((uint8*)p1)[511] = 7;
+        p1 = allocator.realloc(p1, 1024);
+        EXPECT_EQ(((uint8*)p1)[511], 7);
+
+        allocator.free(p3);
+        allocator.free(p2);
+        allocator.free(p1);
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, AllocAligned) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        std::vector<void*> plist;
+        for (uint32 align = 1; align <= 1024 * 1024; align <<= 1) {
+            for (uint32 size : { 1u, 100u, 700u, 5000u, 20u * 1024u * 1024u }) {
+                void* p = allocator.allocAligned(size, align);
+                EXPECT_TRUE(p != nullptr);
+                EXPECT_EQ((uintptr_t)p % std::max(align, DEFAULT_ALIGNMENT), 0);
+                memset(p, 0xee, size);
+                plist.push_back(p);
+            }
+        }
+
+        for (int i = 0; i < 1000; i++) {
+            void* p = allocator.alloc(1 + rand() % 10000);
+            EXPECT_EQ((uintptr_t)p % DEFAULT_ALIGNMENT, 0);
+            plist.push_back(p);
+        }
+
+        for (auto &p : plist)
+            allocator.free(p);
+
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, SizedFree) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        std::vector<std::pair<void*, uint32>> plist;
+        for (uint32 size : { 0u, 1u, 16u, 17u, 300u, 512u, 513u, 100000u, CoalesceAllocator::PAGE_SIZE, 20u * 1024u * 1024u })
+            plist.emplace_back(allocator.alloc(size), size);
+
+        void* p = allocator.alloc(20);
+        p = allocator.realloc(p, 600);
+        p = allocator.realloc(p, 100);
+        plist.emplace_back(p, 100);
+
+        void* aligned = allocator.allocAligned(100, 256);
+        allocator.freeAligned(aligned, 100, 256);
+
+        for (auto &[ptr, size] : plist)
+            allocator.free(ptr, size);
+
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, SizedFreeWrongSize) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        void* p = allocator.alloc(100);
+        EXPECT_DEATH(allocator.free(p, 20), "");
+        EXPECT_DEATH(allocator.free(p, 4096), "");
+        allocator.free(p, 100);
+
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, AllocZeroed) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        for (uint32 size : { 1u, 100u, 512u, 1000u, 300u * 1024u, 17u * 1024u * 1024u }) {
+            // Fresh memory first, then a block that was dirtied and released
+            for (int i = 0; i < 2; i++) {
+                auto* p = (uint8*)allocator.allocZeroed(size);
+                uint64 usable = allocator.usableSize(p);
+                for (uint64 j = 0; j < usable; j++) {
+                    if (p[j] != 0) {
+                        ADD_FAILURE() << "size " << size << " byte " << j;
+                        break;
+                    }
+                }
+
+                memset(p, 0xff, usable);
+                allocator.free(p, size);
+            }
+        }
+
+        allocator.destroy();
+    }
+
+    static size_t countOsPages(const std::vector<uint8*>& blocks) {
+        std::vector<uintptr_t> pages;
+        for (uint8* p : blocks)
+            pages.push_back((uintptr_t)p / 4096);
+        std::sort(pages.begin(), pages.end());
+        return std::unique(pages.begin(), pages.end()) - pages.begin();
+    }
+
+    TEST(CompositeMemoryAllocator, AllocColocatedGroupsScatteredKeys) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        // Holes all over three FSA pages
+        std::vector<void*> plist;
+        for (int i = 0; i < 3 * 4096; i++)
+            plist.push_back(allocator.alloc(64));
+        for (int i = 0; i < 3 * 4096; i += 2)
+            allocator.free(plist[i], 64);
+
+        // Interleaved plain allocs fill the holes, so each list is spread over many pages
+        std::vector<uint8*> first, second;
+        for (int i = 0; i < 1000; i++) {
+            first.push_back((uint8*)allocator.alloc(64));
+            second.push_back((uint8*)allocator.alloc(64));
+        }
+        EXPECT_GE(countOsPages(first), 60u);
+        EXPECT_GE(countOsPages(second), 60u);
+
+        for (auto* blocks : { &first, &second }) {
+            for (uint8* p : *blocks)
+                allocator.free(p, 64);
+            blocks->clear();
+        }
+
+        // The same interleaving by key packs each list into 16 runs of 4KB, each one
+        // may straddle two OS pages
+        for (int i = 0; i < 1000; i++) {
+            first.push_back((uint8*)allocator.allocColocated(64, 1));
+            second.push_back((uint8*)allocator.allocColocated(64, 2));
+        }
+        EXPECT_LE(countOsPages(first), 32u);
+        EXPECT_LE(countOsPages(second), 32u);
+        for (int i = 1; i < 1000; i++) {
+            if (i % COLOCATION_RUN_LENGTH != 0)
+                EXPECT_EQ(first[i] - first[i - 1], 64);
+        }
+
+        for (auto* blocks : { &first, &second }) {
+            for (uint8* p : *blocks)
+                allocator.free(p, 64);
+        }
+        for (int i = 1; i < 3 * 4096; i += 2)
+            allocator.free(plist[i], 64);
+
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, TrimReturnsColocationRuns) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        // The first FSA64 page is full, the run comes from a second one
+        std::vector<void*> plist;
+        for (int i = 0; i < 4096; i++)
+            plist.push_back(allocator.alloc(64));
+        allocator.trim();
+
+        void* p = allocator.allocColocated(64, 1);
+        allocator.free(p, 64);
+        // The rest of the run would keep the second page alive
+        EXPECT_GE(allocator.trim(), 4096u * 64);
+
+        void* q = allocator.allocColocated(64, 1);
+        EXPECT_NE(q, nullptr);
+        allocator.free(q, 64);
+
+        for (void* block : plist)
+            allocator.free(block, 64);
+
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, PageHeapMovesPagesBetweenClasses) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        // 20 FSA16 pages, all but the first one released to the page heap
+        std::vector<uint8*> small;
+        for (int i = 0; i < 20 * 4096; i++)
+            small.push_back((uint8*)allocator.alloc(16));
+        auto [lo, hi] = std::minmax_element(small.begin(), small.end());
+        uint8* smallLo = *lo + 16 * 4096;
+        uint8* smallHi = *hi;
+
+        for (uint8* p : small)
+            allocator.free(p, 16);
+        EXPECT_GT(allocator.trim(), 0u);
+
+        uint64 capacity = allocator.getPageHeap().getCapacity();
+        uint32 spans = allocator.getPageHeap().getSpanCount();
+
+        // FSA64 pages are cut from the released ranges without reserving more
+        std::vector<uint8*> medium;
+        bool reused = false;
+        for (int i = 0; i < 4 * 4096; i++) {
+            medium.push_back((uint8*)allocator.alloc(64));
+            reused |= medium.back() >= smallLo && medium.back() <= smallHi;
+        }
+        EXPECT_TRUE(reused);
+        EXPECT_EQ(allocator.getPageHeap().getCapacity(), capacity);
+        EXPECT_EQ(allocator.getPageHeap().getSpanCount(), spans);
+
+        for (uint8* p : medium)
+            allocator.free(p, 64);
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, PageHeapGrowsBySpans) {
+        PageArena::PageArena heap;
+        heap.initGrowable(PageArena::SPAN_ALIGNMENT * 4);
+
+        void* a = heap.allocPages(PageArena::SPAN_ALIGNMENT * 2);
+        void* b = heap.allocPages(PageArena::SPAN_ALIGNMENT * 2);
+        // Bigger than a span: gets a span of its own
+        void* c = heap.allocPages(PageArena::SPAN_ALIGNMENT * 10);
+        ASSERT_TRUE(a && b && c);
+        EXPECT_EQ(heap.getSpanCount(), 3u);
+        memset(c, 1, PageArena::SPAN_ALIGNMENT * 10);
+
+        // Only the range of a is big enough again
+        heap.freePages(a, PageArena::SPAN_ALIGNMENT * 2);
+        EXPECT_EQ(heap.allocPages(PageArena::SPAN_ALIGNMENT * 2), a);
+        EXPECT_EQ(*(uint64*)a, 0u);
+        // The span header is not part of the heap
+        EXPECT_FALSE(heap.containsAddress((uint8*)c - PageArena::PAGE_SIZE));
+
+        heap.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, PageHeapDecommitsOnlyOnTrim) {
+        PageArena::PageArena heap;
+        heap.initGrowable(PageArena::SPAN_ALIGNMENT * 4);
+
+        auto* a = (uint8*)heap.allocPages(PageArena::SPAN_ALIGNMENT);
+        auto* b = (uint8*)heap.allocPages(PageArena::SPAN_ALIGNMENT);
+        ASSERT_TRUE(a && b);
+        memset(a, 1, PageArena::SPAN_ALIGNMENT);
+
+        // A freed run stays committed and is cleared when it is handed out again
+        heap.freePages(a, PageArena::SPAN_ALIGNMENT);
+        EXPECT_EQ(heap.trim(), PageArena::SPAN_ALIGNMENT - PageArena::PAGE_SIZE);
+        EXPECT_EQ(heap.allocPages(PageArena::SPAN_ALIGNMENT), a);
+        EXPECT_EQ(a[PageArena::SPAN_ALIGNMENT - 1], 0);
+        memset(a, 1, PageArena::SPAN_ALIGNMENT);
+        heap.freePages(a, PageArena::SPAN_ALIGNMENT);
+        EXPECT_EQ(heap.allocPages(PageArena::SPAN_ALIGNMENT), a);
+        EXPECT_EQ(a[PageArena::SPAN_ALIGNMENT - 1], 0);
+
+        // With no page in use the span goes back to the OS
+        heap.freePages(a, PageArena::SPAN_ALIGNMENT);
+        heap.freePages(b, PageArena::SPAN_ALIGNMENT);
+        EXPECT_EQ(heap.getSpanCount(), 1u);
+        EXPECT_GT(heap.trim(), 0u);
+        EXPECT_EQ(heap.getSpanCount(), 0u);
+        EXPECT_EQ(heap.getCapacity(), 0u);
+
+        EXPECT_NE(heap.allocPages(PageArena::SPAN_ALIGNMENT), nullptr);
+        EXPECT_EQ(heap.getSpanCount(), 1u);
+        heap.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, ReservedRangeServesEveryTier) {
+        CompositeMemoryAllocator allocator;
+        ASSERT_TRUE(allocator.initReserved(1ull << 30));
+        EXPECT_TRUE(allocator.isReserved());
+
+        std::vector<void*> plist;
+        for (uint32 size : { 16u, 100u, 512u, 1000u, 300u * 1024u, 17u * 1024u * 1024u }) {
+            auto* p = (uint8*)allocator.allocZeroed(size);
+            ASSERT_NE(p, nullptr);
+            EXPECT_TRUE(allocator.owns(p));
+            EXPECT_GE(allocator.usableSize(p), size);
+            EXPECT_EQ(p[size - 1], 0);
+            memset(p, 0xFF, size);
+            plist.push_back(p);
+        }
+
+        void* growable = allocator.allocGrowable(64ull * 1024 * 1024);
+        ASSERT_TRUE(allocator.grow(growable, 8ull * 1024 * 1024));
+        memset(growable, 1, 8ull * 1024 * 1024);
+        EXPECT_TRUE(allocator.owns(growable));
+
+        int local = 0;
+        EXPECT_FALSE(allocator.owns(&local));
+
+        // The tier comes from the address, no size is needed
+        for (void* p : plist)
+            allocator.free(p);
+        allocator.free(growable);
+
+        allocator.destroy();
+        EXPECT_FALSE(allocator.isReserved());
+    }
+
+    TEST(CompositeMemoryAllocator, ReservedRangeOverflowsToVirtualAlloc) {
+        CompositeMemoryAllocator allocator;
+        ASSERT_TRUE(allocator.initReserved(256ull * 1024 * 1024));
+
+        // Bigger than the big block region, reserved outside the range
+        uint64 size = 64ull * 1024 * 1024;
+        auto* big = (uint8*)allocator.alloc((uint32)size);
+        ASSERT_NE(big, nullptr);
+        memset(big, 0xAB, size);
+        EXPECT_TRUE(allocator.owns(big));
+        EXPECT_GE(allocator.usableSize(big), size);
+
+        void* small = allocator.alloc(64);
+        ASSERT_NE(small, nullptr);
+        EXPECT_TRUE(allocator.owns(small));
+
+        allocator.free(big);
+        allocator.free(small);
+        EXPECT_FALSE(allocator.owns(big));
+
+        allocator.destroy();
+    }
+
+    struct SmallClassesConfig {
+        static constexpr uint32 MIN_FSA_SHIFT = FSABlockSize::FSA16;
+        static constexpr uint32 FSA_CLASS_COUNT = 4;
+        static constexpr bool USE_COALESCE = false;
+        static constexpr bool DEBUG_CHECKS = true;
+    };
+
+    TEST(CompositeMemoryAllocator, CustomConfigRoutesAboveLastClassToVirtual) {
+        using SmallAllocator = CompositeMemoryAllocatorT<SmallClassesConfig>;
+        static_assert(SmallAllocator::MAX_FSA_SIZE == 128);
+        static_assert(SmallAllocator::MAX_COALESCE_SIZE == 128);
+
+        SmallAllocator allocator;
+        allocator.init();
+
+        void* small = allocator.alloc(100);
+        ASSERT_NE(small, nullptr);
+        EXPECT_EQ(allocator.usableSize(small), 128u);
+        EXPECT_EQ(allocator.goodSize(100), 128u);
+
+        // Without Coalesce the next tier is VirtualAlloc
+        void* big = allocator.alloc(200);
+        ASSERT_NE(big, nullptr);
+        EXPECT_TRUE(allocator.owns(big));
+        EXPECT_GE(allocator.usableSize(big), 200u);
+        EXPECT_EQ(allocator.getPageHeap().containsAddress(big), false);
+        memset(big, 0xFF, 200);
+
+        allocator.free(small, 100);
+        allocator.free(big, 200);
+        allocator.destroy();
+    }
+
+    TEST(CompositeMemoryAllocator, CustomTierServesItsSizeRange) {
+        CompositeMemoryAllocator allocator;
+        allocator.init();
+
+        Tier::FixedSizeTier ioBuffers;
+        ioBuffers.init(4096);
+        ASSERT_TRUE(allocator.addTier(&ioBuffers, 4096, 4096));
+        // 4000 shares the routing bucket of 4096
+        Tier::FixedSizeTier overlapping;
+        EXPECT_FALSE(allocator.addTier(&overlapping, 4000, 4000));
+
+        void* buffer = allocator.alloc(4096);
+        ASSERT_NE(buffer, nullptr);
+        EXPECT_TRUE(ioBuffers.owns(buffer));
+        EXPECT_TRUE(allocator.owns(buffer));
+        EXPECT_EQ(allocator.usableSize(buffer), 4096u);
+
+        // The rest of the bucket keeps its built-in tier
+        void* other = allocator.alloc(4000);
+        EXPECT_FALSE(ioBuffers.owns(other));
+        EXPECT_TRUE(allocator.owns(other));
+
+        void* second = allocator.allocZeroed(4096);
+        EXPECT_TRUE(ioBuffers.owns(second));
+        EXPECT_EQ(((uint8*)second)[4095], 0);
+
+        allocator.free(buffer, 4096);
+        allocator.free(second);
+        allocator.free(other);
+        EXPECT_EQ(ioBuffers.getStat().freeCallCount, 2u);
+        EXPECT_EQ(ioBuffers.getStat().liveSize, 0u);
+
+        // realloc out of the range moves the block to the built-in tiers
+        void* moved = allocator.realloc(allocator.alloc(4096), 8192);
+        EXPECT_FALSE(ioBuffers.owns(moved));
+        allocator.free(moved);
+
+        allocator.destroy();
+        ioBuffers.destroy();
+    }
+}
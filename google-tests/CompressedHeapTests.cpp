@@ -0,0 +1,109 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <CompressedAllocatorT.h>
+
+#include <map>
+
+namespace CompressedHeap {
+    using MemoryAllocator::CompressedHeapSingleton;
+
+    struct TreeNode {
+        CompressedPtr<TreeNode> left;
+        CompressedPtr<TreeNode> right;
+        uint32 key;
+    };
+
+    TEST(CompressedHeap, PointerRoundTrip)
+    {
+        CompressedHeapSingleton::init();
+        auto& allocator = *CompressedHeapSingleton::allocator;
+
+        static_assert(sizeof(CompressedPtr<TreeNode>) == 4);
+        static_assert(sizeof(TreeNode) == 12);
+
+        uint32 sizes[] = { 8, 100, 4000, 20 * 1024 * 1024 };
+        for (uint32 size : sizes) {
+            auto* p = (uint64*)allocator.alloc(size);
+            CompressedPtr<uint64> compressed = p;
+            EXPECT_EQ(compressed.get(), p);
+            EXPECT_TRUE(compressed);
+            EXPECT_GT(compressed.getOffset(), 0u);
+            allocator.free(p);
+        }
+
+        CompressedPtr<uint64> null;
+        EXPECT_EQ(null.get(), nullptr);
+        EXPECT_FALSE(null);
+        null = (uint64*)nullptr;
+        EXPECT_EQ(null.getOffset(), 0u);
+    }
+
+    TEST(CompressedHeap, LinkedNodes)
+    {
+        CompressedHeapSingleton::init();
+        auto& allocator = *CompressedHeapSingleton::allocator;
+
+        // Unbalanced search tree, every link is 4 bytes
+        TreeNode* root = nullptr;
+        uint32 key = 1;
+        for (uint32 i = 0; i < 1000; i++) {
+            key = key * 1103515245u + 12345u;
+            auto* node = (TreeNode*)allocator.alloc(sizeof(TreeNode));
+            node->left = nullptr;
+            node->right = nullptr;
+            node->key = key;
+
+            if (!root) {
+                root = node;
+                continue;
+            }
+
+            TreeNode* parent = root;
+            while (true) {
+                CompressedPtr<TreeNode>& next = key < parent->key ? parent->left : parent->right;
+                if (!next) {
+                    next = node;
+                    break;
+                }
+                parent = next;
+            }
+        }
+
+        uint32 count = 0;
+        uint32 last = 0;
+        auto visit = [&](auto& self, TreeNode* node) -> void {
+            if (!node)
+                return;
+            self(self, node->left);
+            EXPECT_GE(node->key, last);
+            last = node->key;
+            count++;
+            self(self, node->right);
+        };
+        visit(visit, root);
+        EXPECT_EQ(count, 1000);
+
+        auto release = [&](auto& self, TreeNode* node) -> void {
+            if (!node)
+                return;
+            self(self, node->left);
+            self(self, node->right);
+            allocator.free(node);
+        };
+        release(release, root);
+    }
+
+    TEST(CompressedHeap, ContainerStaysInRange)
+    {
+        std::map<uint32, uint32, std::less<>, MemoryAllocator::CompressedAllocatorT<std::pair<const uint32, uint32>>> map;
+        for (uint32 i = 0; i < 10000; i++)
+            map[i] = i * 2;
+
+        uint8* base = CompressedHeap::getBase();
+        for (auto& [key, value] : map) {
+            EXPECT_EQ(value, key * 2);
+            EXPECT_GT((uint8*)&value, base);
+            EXPECT_LT((uint8*)&value, base + MAX_CAPACITY);
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <EpochDomain.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace EpochDomain {
+    TEST(EpochDomain, RetiredBlockWaitsForReaders)
+    {
+        CompositeMemoryAllocator::CompositeMemoryAllocator allocator;
+        allocator.init();
+        auto domain = std::make_unique<EpochDomain>();
+        domain->init(&allocator, nullptr);
+
+        EpochDomain::ThreadRecord* reader = domain->registerThread();
+        EpochDomain::ThreadRecord* writer = domain->registerThread();
+
+        domain->enter(reader);
+
+        void* p = allocator.alloc(64);
+        domain->enter(writer);
+        domain->retire(writer, p, 64);
+        domain->exit(writer);
+
+        domain->flush(writer);
+        EXPECT_EQ(domain->getStat().reclaimedCount, 0u);
+
+        domain->exit(reader);
+        domain->flush(writer);
+        EXPECT_EQ(domain->getStat().retiredCount, 1u);
+        EXPECT_EQ(domain->getStat().reclaimedCount, 1u);
+
+        domain->unregisterThread(reader);
+        domain->unregisterThread(writer);
+        domain->destroy();
+        allocator.destroy();
+    }
+
+    TEST(EpochDomain, ConcurrentReadersAndWriters)
+    {
+        static constexpr uint64 MAGIC = 0x0123456789ABCDEFull;
+        struct Node {
+            uint64 magic;
+            uint64 value;
+        };
+
+        CompositeMemoryAllocator::CompositeMemoryAllocator allocator;
+        allocator.init();
+        std::mutex allocatorLock;
+        auto domain = std::make_unique<EpochDomain>();
+        domain->init(&allocator, &allocatorLock);
+
+        auto* first = (Node*)allocator.alloc(sizeof(Node));
+        *first = Node{ MAGIC, 0 };
+        std::atomic<Node*> slot{ first };
+
+        std::vector<std::thread> threads;
+        for (uint32 t = 0; t < 4; t++) {
+            threads.emplace_back([&, t]() {
+                EpochDomain::ThreadRecord* record = domain->registerThread();
+                for (uint64 i = 0; i < 20000; i++) {
+                    EpochGuard guard(*domain, record);
+
+                    // A node freed too early would have its first word overwritten by the FSA free list
+                    Node* node = slot.load();
+                    ASSERT_EQ(node->magic, MAGIC);
+
+                    if ((i + t) % 2 == 0) {
+                        Node* replacement;
+                        {
+                            std::lock_guard<std::mutex> lock(allocatorLock);
+                            replacement = (Node*)allocator.alloc(sizeof(Node));
+                        }
+                        *replacement = Node{ MAGIC, i };
+
+                        Node* old = slot.exchange(replacement);
+                        domain->retire(record, old, sizeof(Node));
+                    }
+                }
+
+                domain->flush(record);
+                domain->unregisterThread(record);
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        domain->destroy();
+        EXPECT_EQ(domain->getStat().reclaimedCount, domain->getStat().retiredCount);
+
+        allocator.free(slot.load());
+        allocator.destroy();
+    }
+}
@@ -2,6 +2,8 @@
 
 #include <FixedSizeAllocator.h>
 
+#include <algorithm>
+
 namespace FixedSizeAllocator {
     void AllocateRange(FixedSizeAllocator &allocator, std::vector<void*> &plist, int count, uint32 size) {
         for (int i = 0; i < count; i++) {
@@ -133,4 +135,189 @@ namespace FixedSizeAllocator {
 
         fsa.destroy();
     }
-}
\ No newline at end of file
+
+    TEST(FSA, NaturalAlignment)
+    {
+        for (uint32 blockSize = 16; blockSize <= 512; blockSize <<= 1) {
+            FixedSizeAllocator fsa;
+            fsa.init(blockSize);
+            std::vector<void*> plist;
+            AllocateRange(fsa, plist, 100, blockSize);
+            for (void* p : plist)
+                EXPECT_EQ((uintptr_t)p % blockSize, 0);
+            FreeRangeRandom(fsa, plist, 100);
+            fsa.destroy();
+        }
+    }
+
+    TEST(FSA, TrimReleasesEmptyPages)
+    {
+        FixedSizeAllocator fsa;
+        fsa.init(64);
+        std::vector<void*> plist;
+        AllocateRange(fsa, plist, 3 * PAGE_SIZE, 64);
+
+        // Only the middle page becomes empty
+        for (int i = PAGE_SIZE; i < 2 * PAGE_SIZE; i++)
+            fsa.free(plist[i]);
+        plist.erase(plist.begin() + PAGE_SIZE, plist.begin() + 2 * PAGE_SIZE);
+
+        EXPECT_GT(fsa.trim(), 0u);
+        EXPECT_EQ(fsa.trim(), 0u);
+        EXPECT_TRUE(fsa.containsAddress(plist.back()));
+
+        for (void* p : plist)
+            fsa.free(p);
+        fsa.destroy();
+    }
+
+    TEST(FSA, TypeStableKeepsFreedBlocks)
+    {
+        FixedSizeAllocator fsa;
+        fsa.init(64, nullptr, true);
+        std::vector<void*> plist;
+        AllocateRange(fsa, plist, 2 * PAGE_SIZE, 64);
+
+        for (void* p : plist)
+            *(uint64*)p = (uintptr_t)p;
+        for (void* p : plist)
+            fsa.free(p);
+
+        // Freed blocks stay mapped and keep their first word
+        EXPECT_EQ(fsa.trim(), 0u);
+        for (void* p : plist) {
+            EXPECT_TRUE(fsa.containsAddress(p));
+            EXPECT_EQ(*(uint64*)p, (uintptr_t)p);
+        }
+
+        // The free list still hands every block back
+        std::vector<void*> reused;
+        AllocateRange(fsa, reused, 2 * PAGE_SIZE, 64);
+        std::sort(plist.begin(), plist.end());
+        std::sort(reused.begin(), reused.end());
+        EXPECT_EQ(plist, reused);
+
+        for (void* p : reused)
+            fsa.free(p);
+        fsa.destroy();
+    }
+
+    TEST(FSA, AllocNearTakesClosestBlockOfHintPage)
+    {
+        FixedSizeAllocator fsa;
+        fsa.init(64);
+        std::vector<void*> plist;
+        AllocateRange(fsa, plist, 2 * PAGE_SIZE, 64);
+
+        fsa.free(plist[3000]);
+        fsa.free(plist[100]);
+        fsa.free(plist[PAGE_SIZE + 5]);
+
+        EXPECT_EQ(fsa.allocNear(64, plist[PAGE_SIZE + 6]), plist[PAGE_SIZE + 5]);
+        // 100 heads the free list, 3000 is closer
+        EXPECT_EQ(fsa.allocNear(64, plist[2999]), plist[3000]);
+        // The hint page is full, so the block comes from anywhere
+        EXPECT_EQ(fsa.allocNear(64, plist[PAGE_SIZE]), plist[100]);
+
+        for (void* p : plist)
+            fsa.free(p);
+        fsa.destroy();
+    }
+
+    TEST(FSA, AllocRunIsContiguous)
+    {
+        FixedSizeAllocator fsa;
+        fsa.init(32);
+        std::vector<void*> plist;
+        AllocateRange(fsa, plist, PAGE_SIZE - 10, 32);
+
+        // Free-list blocks are skipped, the run doesn't fit into the first page
+        fsa.free(plist[0]);
+        plist.erase(plist.begin());
+
+        auto* run = (uint8*)fsa.allocRun(100);
+        ASSERT_NE(run, nullptr);
+        EXPECT_NE(run, (uint8*)plist.back() + 32);
+        for (int i = 0; i < 100; i++) {
+            for (int j = 0; j < 32; j++)
+                EXPECT_EQ(run[i * 32 + j], 0);
+            memset(run + i * 32, 0xFF, 32);
+        }
+
+        // The tail of the first page still fits a short run
+        auto* tail = (uint8*)fsa.allocRun(10);
+        EXPECT_EQ(tail, (uint8*)plist.back() + 32);
+
+        EXPECT_EQ(fsa.allocRun(PAGE_SIZE + 1), nullptr);
+
+        for (int i = 0; i < 100; i++)
+            fsa.free(run + i * 32);
+        for (int i = 0; i < 10; i++)
+            fsa.free(tail + i * 32);
+        for (void* p : plist)
+            fsa.free(p);
+        fsa.destroy();
+    }
+
+    TEST(FSA, AddressOrderedReusesLowestBlock)
+    {
+        FixedSizeAllocator fsa;
+        fsa.init(64, nullptr, false, ReusePolicy::AddressOrdered);
+        std::vector<void*> plist;
+        AllocateRange(fsa, plist, PAGE_SIZE + 1, 64);
+
+        fsa.free(plist[500]);
+        fsa.free(plist[10]);
+        fsa.free(plist[2000]);
+
+        EXPECT_EQ(fsa.alloc(64), plist[10]);
+        EXPECT_EQ(fsa.alloc(64), plist[500]);
+        EXPECT_EQ(fsa.alloc(64), plist[2000]);
+        // The second page has never used blocks only
+        EXPECT_EQ(fsa.alloc(64), (uint8*)plist[PAGE_SIZE] + 64);
+
+        fsa.free((uint8*)plist[PAGE_SIZE] + 64);
+        for (void* p : plist)
+            fsa.free(p);
+        fsa.destroy();
+    }
+
+    TEST(FSA, FullestPageDrainsSparsePages)
+    {
+        FixedSizeAllocator fsa;
+        fsa.init(64, nullptr, false, ReusePolicy::FullestPage);
+        std::vector<void*> plist;
+        AllocateRange(fsa, plist, 3 * PAGE_SIZE, 64);
+
+        // Page 0 keeps 100 holes, page 1 only 10 live blocks, page 2 keeps 50 holes
+        std::vector<void*> holes;
+        for (int i = 0; i < 3 * PAGE_SIZE; i++) {
+            bool hole = i < 100 || (i >= PAGE_SIZE + 10 && i < 2 * PAGE_SIZE) || i >= 3 * PAGE_SIZE - 50;
+            if (hole) {
+                fsa.free(plist[i]);
+                holes.push_back(plist[i]);
+            }
+        }
+
+        // New blocks fill the holes of pages 0 and 2 before touching page 1
+        std::vector<void*> reused;
+        AllocateRange(fsa, reused, 150, 64);
+        for (void* p : reused) {
+            EXPECT_TRUE(p < plist[PAGE_SIZE] || p >= plist[2 * PAGE_SIZE]);
+            EXPECT_NE(std::find(holes.begin(), holes.end(), p), holes.end());
+        }
+
+        // Page 1 empties out and can be released
+        for (int i = PAGE_SIZE; i < PAGE_SIZE + 10; i++)
+            fsa.free(plist[i]);
+        EXPECT_GT(fsa.trim(), 0u);
+
+        for (void* p : reused)
+            fsa.free(p);
+        for (int i = 100; i < PAGE_SIZE; i++)
+            fsa.free(plist[i]);
+        for (int i = 2 * PAGE_SIZE; i < 3 * PAGE_SIZE - 50; i++)
+            fsa.free(plist[i]);
+        fsa.destroy();
+    }
+}
@@ -0,0 +1,54 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <GlobalAllocator.h>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace GlobalAllocator {
+    TEST(GlobalAllocator, SizedAndAlignedFree)
+    {
+        GlobalAllocator& global = GlobalAllocator::instance;
+
+        std::vector<std::pair<void*, uint32>> blocks;
+        for (uint32 size : { 1u, 16u, 100u, 512u, 4000u, 300000u, 20u * 1024u * 1024u }) {
+            void* p = global.alloc(size);
+            ASSERT_NE(p, nullptr);
+            EXPECT_TRUE(global.owns(p));
+            EXPECT_GE(global.usableSize(p), size);
+            memset(p, 0xAB, size);
+            blocks.emplace_back(p, size);
+        }
+        for (auto& [p, size] : blocks)
+            global.free(p, size);
+
+        for (uint32 align : { 64u, 1024u, 8192u }) {
+            void* p = global.allocAligned(200, align);
+            ASSERT_NE(p, nullptr);
+            EXPECT_EQ((uint64)p % align, 0u);
+            global.freeAligned(p, 200, align);
+        }
+    }
+
+#if defined(CMA_OVERRIDE_GLOBAL_NEW)
+    TEST(GlobalAllocator, GlobalNewUsesIt)
+    {
+        struct alignas(128) Aligned {
+            uint8 bytes[100];
+        };
+
+        auto values = std::make_unique<std::vector<int>>(1000, 7);
+        EXPECT_TRUE(GlobalAllocator::instance.owns(values.get()));
+        EXPECT_TRUE(GlobalAllocator::instance.owns(values->data()));
+
+        auto aligned = std::make_unique<Aligned>();
+        EXPECT_TRUE(GlobalAllocator::instance.owns(aligned.get()));
+        EXPECT_EQ((uint64)aligned.get() % 128, 0u);
+
+        auto* nothrow = new (std::nothrow) Aligned[3];
+        EXPECT_TRUE(GlobalAllocator::instance.owns(nothrow));
+        delete[] nothrow;
+    }
+#endif
+}
@@ -0,0 +1,45 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <GrowableVectorT.h>
+
+#include <string>
+
+namespace MemoryAllocator {
+    TEST(GrowableVector, PushBackKeepsAddress)
+    {
+        GrowableVectorT<uint64> v(1024 * 1024);
+        v.push_back(0);
+        uint64* first = &v[0];
+
+        for (uint64 i = 1; i < 1024 * 1024; i++)
+            v.push_back(i);
+
+        EXPECT_EQ(&v[0], first);
+        EXPECT_EQ(v.size(), 1024 * 1024);
+        for (uint64 i = 0; i < v.size(); i++)
+            EXPECT_EQ(v[i], i);
+
+        EXPECT_THROW(v.push_back(0), std::length_error);
+    }
+
+    TEST(GrowableVector, NonTrivialElements)
+    {
+        GrowableVectorT<std::string> v(1000);
+        for (int i = 0; i < 1000; i++)
+            v.emplace_back(std::to_string(i));
+
+        EXPECT_EQ(v.back(), "999");
+        v.pop_back();
+        EXPECT_EQ(v.back(), "998");
+
+        GrowableVectorT<std::string> moved(std::move(v));
+        EXPECT_EQ(moved.size(), 999);
+        EXPECT_TRUE(v.empty());
+    }
+
+    TEST(GrowableVector, OverflowingMaxCountIsRejected)
+    {
+        EXPECT_THROW(GrowableVectorT<uint64>(SIZE_MAX / 4), std::length_error);
+        EXPECT_EQ(GlobalAllocator::GlobalAllocator::instance.allocGrowable(UINT64_MAX), nullptr);
+    }
+}
@@ -0,0 +1,86 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <HandleHeap.h>
+
+#include <cstring>
+#include <vector>
+
+namespace HandleHeap {
+    TEST(HandleHeap, PinReturnsData)
+    {
+        HandleHeap heap;
+        heap.init();
+
+        Handle h = heap.allocHandle(100);
+        ASSERT_NE(h, INVALID_HANDLE);
+
+        auto* p = (char*)heap.pin(h);
+        strcpy(p, "relocatable");
+        heap.unpin(h);
+
+        EXPECT_STREQ((char*)heap.pin(h), "relocatable");
+        heap.unpin(h);
+
+        heap.freeHandle(h);
+        heap.destroy();
+    }
+
+    TEST(HandleHeap, CompactSlidesUnpinnedBlocks)
+    {
+        HandleHeap heap;
+        heap.init();
+
+        std::vector<Handle> handles;
+        for (uint32 i = 0; i < 1000; i++) {
+            Handle h = heap.allocHandle(1000);
+            memset(heap.pin(h), (int)i, 1000);
+            heap.unpin(h);
+            handles.push_back(h);
+        }
+
+        // Every other block freed leaves the page fragmented
+        std::vector<std::pair<Handle, uint32>> live;
+        for (uint32 i = 0; i < handles.size(); i++) {
+            if (i % 2)
+                heap.freeHandle(handles[i]);
+            else
+                live.emplace_back(handles[i], i);
+        }
+
+        Handle pinned = live[10].first;
+        void* pinnedAddress = heap.pin(pinned);
+        void* lastAddress = heap.pin(live.back().first);
+        heap.unpin(live.back().first);
+
+        // Small steps until the pass is done
+        CoalesceAllocator::CompactResult total;
+        while (true) {
+            auto result = heap.compact(16);
+            EXPECT_LE(result.movedCount, 16u);
+            total.movedCount += result.movedCount;
+            total.releasedSize += result.releasedSize;
+            if (result.passDone)
+                break;
+        }
+
+        EXPECT_GT(total.movedCount, 0u);
+        EXPECT_GT(total.releasedSize, 0u);
+        EXPECT_EQ(heap.pin(pinned), pinnedAddress);
+        heap.unpin(pinned);
+        heap.unpin(pinned);
+
+        void* movedAddress = heap.pin(live.back().first);
+        EXPECT_LT(movedAddress, lastAddress);
+        heap.unpin(live.back().first);
+
+        for (auto& [h, value] : live) {
+            auto* p = (uint8*)heap.pin(h);
+            for (uint32 i = 0; i < 1000; i++)
+                ASSERT_EQ(p[i], (uint8)value);
+            heap.unpin(h);
+            heap.freeHandle(h);
+        }
+
+        heap.destroy();
+    }
+}
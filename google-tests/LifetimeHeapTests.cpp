@@ -0,0 +1,68 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <LifetimeHeap.h>
+
+#include <memory>
+#include <vector>
+
+namespace LifetimeHeap {
+    TEST(LifetimeHeap, ExplicitLifetimeSeparatesPages)
+    {
+        auto heap = std::make_unique<LifetimeHeap>();
+        heap->init();
+
+        std::vector<void*> temporaries;
+        std::vector<void*> survivors;
+        for (uint32 i = 0; i < 20000; i++) {
+            temporaries.push_back(heap->alloc(64, Lifetime::Short));
+            if (i % 1000 == 0)
+                survivors.push_back(heap->alloc(64, Lifetime::Long));
+        }
+
+        EXPECT_TRUE(heap->allocator(Lifetime::Short).owns(temporaries.back()));
+        EXPECT_TRUE(heap->allocator(Lifetime::Long).owns(survivors.back()));
+        EXPECT_FALSE(heap->allocator(Lifetime::Short).owns(survivors.back()));
+
+        for (void* p : temporaries)
+            heap->free(p);
+
+        // Survivors did not keep any short-lived page alive
+        EXPECT_GT(heap->trim(Lifetime::Short), 0u);
+        EXPECT_EQ(heap->trim(Lifetime::Long), 0u);
+
+        for (void* p : survivors)
+            heap->free(p);
+
+        heap->destroy();
+    }
+
+    TEST(LifetimeHeap, PredictsLifetimePerSite)
+    {
+        auto heap = std::make_unique<LifetimeHeap>();
+        heap->init();
+
+        static const int temporarySite = 0;
+        static const int cacheSite = 0;
+
+        EXPECT_EQ(heap->predict(&temporarySite), Lifetime::Long);
+
+        std::vector<void*> cache;
+        for (uint32 i = 0; i < SAMPLE_PERIOD * MIN_SAMPLES * 4; i++) {
+            void* temporary = heap->allocAt(100, &temporarySite);
+            cache.push_back(heap->allocAt(100, &cacheSite));
+            heap->free(temporary);
+        }
+
+        EXPECT_EQ(heap->predict(&temporarySite), Lifetime::Short);
+        EXPECT_EQ(heap->predict(&cacheSite), Lifetime::Long);
+
+        void* p = heap->allocAt(100, &temporarySite);
+        EXPECT_TRUE(heap->allocator(Lifetime::Short).owns(p));
+        heap->free(p);
+
+        for (void* block : cache)
+            heap->free(block);
+
+        heap->destroy();
+    }
+}
@@ -0,0 +1,86 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <GlobalAllocator.h>
+#include <MallocApi.h>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace MallocApi {
+    TEST(MallocApi, FollowsTheCLibrary)
+    {
+        auto* p = (uint8_t*)cma_malloc(100);
+        ASSERT_NE(p, nullptr);
+        EXPECT_EQ((uintptr_t)p % 16, 0u);
+        EXPECT_GE(cma_malloc_usable_size(p), 100u);
+        memset(p, 7, 100);
+
+        p = (uint8_t*)cma_realloc(p, 100000);
+        ASSERT_NE(p, nullptr);
+        EXPECT_EQ(p[99], 7);
+        EXPECT_EQ(cma_realloc(p, 0), nullptr);
+
+        auto* zeroed = (uint8_t*)cma_calloc(1000, 8);
+        ASSERT_NE(zeroed, nullptr);
+        for (int i = 0; i < 8000; i++)
+            ASSERT_EQ(zeroed[i], 0);
+        cma_free(zeroed);
+        EXPECT_EQ(cma_calloc(SIZE_MAX / 2, 4), nullptr);
+
+        for (size_t align : { 32u, 256u, 4096u, 65536u }) {
+            void* aligned = cma_memalign(align, 3000);
+            ASSERT_NE(aligned, nullptr);
+            EXPECT_EQ((uintptr_t)aligned % align, 0u);
+            cma_free(aligned);
+        }
+        EXPECT_EQ(cma_memalign(48, 100), nullptr);
+
+        void* empty = cma_malloc(0);
+        EXPECT_NE(empty, nullptr);
+        cma_free(empty);
+        cma_free(nullptr);
+        EXPECT_EQ(cma_malloc_usable_size(nullptr), 0u);
+    }
+
+    TEST(MallocApi, ConcurrentThreads)
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([t] {
+                std::vector<void*> blocks;
+                for (int i = 0; i < 20000; i++) {
+                    size_t size = 1 + (i * 7919 + t) % 3000;
+                    auto* p = (uint8_t*)cma_malloc(size);
+                    ASSERT_NE(p, nullptr);
+                    p[0] = (uint8_t)t;
+                    p[size - 1] = (uint8_t)t;
+                    blocks.push_back(p);
+                    if (i % 3 == 0) {
+                        auto* q = (uint8_t*)blocks[blocks.size() / 2];
+                        EXPECT_EQ(q[0], (uint8_t)t);
+                        cma_free(q);
+                        blocks[blocks.size() / 2] = blocks.back();
+                        blocks.pop_back();
+                    }
+                }
+                for (void* p : blocks)
+                    cma_free(p);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+#ifdef CMA_SHARED
+    // The DLL links its own copy of the library, its blocks come from a separate reservation
+    TEST(MallocApi, ServedByTheSharedLibrary)
+    {
+        void* p = cma_malloc(64);
+        ASSERT_NE(p, nullptr);
+        EXPECT_FALSE(GlobalAllocator::GlobalAllocator::instance.owns(p));
+        cma_free(p);
+    }
+#endif
+}
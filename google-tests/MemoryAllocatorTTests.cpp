@@ -0,0 +1,101 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <MemoryAllocatorT.h>
+
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace MemoryAllocator {
+    TEST(MemoryAllocatorT, AllocateAtLeast)
+    {
+        MemoryAllocatorT<uint32> allocator;
+
+        auto small = allocator.allocate_at_least(65);
+        EXPECT_EQ(small.count, 128);
+        allocator.deallocate(small.ptr, small.count);
+
+        auto medium = allocator.allocate_at_least(1000);
+        EXPECT_GE(medium.count, 1000);
+        allocator.deallocate(medium.ptr, medium.count);
+    }
+
+    struct CompositeSource {
+        inline static CompositeMemoryAllocator::CompositeMemoryAllocator* allocator = nullptr;
+
+        static void init() {}
+    };
+
+    TEST(MemoryAllocatorT, SizeBeyondTheSourceThrows)
+    {
+        CompositeMemoryAllocator::CompositeMemoryAllocator composite;
+        composite.init();
+        CompositeSource::allocator = &composite;
+
+        // 4GB + 8 bytes would wrap around to an 8-byte block of a uint32 size
+        MemoryAllocatorT<uint64, CompositeSource> allocator;
+        std::size_t n = (1ull << 32) / sizeof(uint64) + 1;
+        EXPECT_THROW(allocator.allocate(n), std::bad_alloc);
+        EXPECT_THROW(allocator.allocate_at_least(n), std::bad_alloc);
+
+        auto block = allocator.allocate_at_least(1000);
+        EXPECT_GE(block.count, 1000u);
+        allocator.deallocate(block.ptr, block.count);
+
+        composite.destroy();
+        CompositeSource::allocator = nullptr;
+    }
+
+    TEST(MemoryAllocatorT, ContainerMoveKeepsBuffer)
+    {
+        std::vector<int, MemoryAllocatorT<int>> v1(1000, 1);
+        const int* data = v1.data();
+
+        std::vector<int, MemoryAllocatorT<int>> v2;
+        v2 = std::move(v1);
+        EXPECT_EQ(v2.data(), data);
+
+        std::vector<int, MemoryAllocatorT<int>> v3(MemoryAllocatorT<int>{});
+        v3.swap(v2);
+        EXPECT_EQ(v3.data(), data);
+        EXPECT_TRUE(MemoryAllocatorT<int>{} == MemoryAllocatorT<char>{});
+    }
+
+    TEST(MemoryAllocatorT, OverAlignedType)
+    {
+        struct alignas(64) CacheLine {
+            uint64 counter;
+        };
+
+        std::vector<CacheLine, MemoryAllocatorT<CacheLine>> lines(3);
+        EXPECT_EQ((uintptr_t)lines.data() % 64, 0);
+
+        std::vector<CacheLine, MemoryAllocatorT<CacheLine>> moreLines(100);
+        EXPECT_EQ((uintptr_t)moreLines.data() % 64, 0);
+
+        // Like realloc, a null block is only allocated
+        MemoryAllocatorT<CacheLine> allocator;
+        CacheLine* grown = allocator.reallocate(nullptr, 0, 4);
+        ASSERT_NE(grown, nullptr);
+        EXPECT_EQ((uintptr_t)grown % 64, 0);
+        EXPECT_EQ(allocator.reallocate(grown, 4, 0), nullptr);
+    }
+
+    TEST(MemoryAllocatorT, ContainersOnSeveralThreads)
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([t] {
+                std::map<int, int, std::less<>, MemoryAllocatorT<std::pair<const int, int>>> values;
+                for (int i = 0; i < 20000; i++)
+                    values[i] = i + t;
+                for (int i = 0; i < 20000; i += 2)
+                    values.erase(i);
+                EXPECT_EQ(values.size(), 10000u);
+                EXPECT_EQ(values[1], 1 + t);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+    }
+}
@@ -0,0 +1,131 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <PersistentHeap.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace PersistentHeap {
+    static const char* HEAP_PATH = "persistent_heap_test.bin";
+    static void* const HEAP_BASE = (void*)0x200000000000ull;
+    static constexpr uint64 HEAP_CAPACITY = 64ull * 1024 * 1024;
+
+    static long fileSize(const char* path) {
+        FILE* file = fopen(path, "rb");
+        if (file == nullptr)
+            return -1;
+
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fclose(file);
+        return size;
+    }
+
+    struct Node {
+        Node* next;
+        uint32 value;
+        char* name;
+    };
+
+    TEST(PersistentHeap, ReopenKeepsObjects)
+    {
+        std::remove(HEAP_PATH);
+
+        {
+            PersistentHeap heap;
+            ASSERT_TRUE(heap.open(HEAP_PATH, HEAP_CAPACITY, HEAP_BASE));
+            EXPECT_FALSE(heap.attached());
+
+            auto& allocator = heap.allocator();
+            Node* head = nullptr;
+            for (uint32 i = 0; i < 100; i++) {
+                auto* node = (Node*)allocator.alloc(sizeof(Node));
+                node->next = head;
+                node->value = i;
+                node->name = (char*)allocator.alloc(1000);
+                snprintf(node->name, 1000, "node %u", i);
+                head = node;
+            }
+            heap.setRoot(0, head);
+
+            auto* big = (uint32*)allocator.alloc(1024 * 1024);
+            big[1024 * 1024 / sizeof(uint32) - 1] = 0xC0FFEE;
+            heap.setRoot(1, big);
+        }
+
+        {
+            PersistentHeap heap;
+            ASSERT_TRUE(heap.open(HEAP_PATH, HEAP_CAPACITY, HEAP_BASE));
+            EXPECT_TRUE(heap.attached());
+
+            auto& allocator = heap.allocator();
+            auto* head = (Node*)heap.getRoot(0);
+            char expected[32];
+            for (uint32 i = 100; i-- > 0; head = head->next) {
+                ASSERT_NE(head, nullptr);
+                EXPECT_EQ(head->value, i);
+                snprintf(expected, sizeof(expected), "node %u", i);
+                EXPECT_STREQ(head->name, expected);
+            }
+            EXPECT_EQ(head, nullptr);
+
+            auto* big = (uint32*)heap.getRoot(1);
+            EXPECT_EQ(big[1024 * 1024 / sizeof(uint32) - 1], 0xC0FFEE);
+
+            // The allocator state came back too: freeing and allocating keeps working
+            head = (Node*)heap.getRoot(0);
+            while (head) {
+                Node* next = head->next;
+                allocator.free(head->name);
+                allocator.free(head);
+                head = next;
+            }
+            allocator.free(big);
+
+            void* p = allocator.alloc(100);
+            EXPECT_NE(p, nullptr);
+            allocator.free(p);
+        }
+
+        std::remove(HEAP_PATH);
+    }
+
+    TEST(PersistentHeap, RejectsMismatchedCapacity)
+    {
+        std::remove(HEAP_PATH);
+
+        {
+            PersistentHeap heap;
+            ASSERT_TRUE(heap.open(HEAP_PATH, HEAP_CAPACITY, HEAP_BASE));
+        }
+
+        {
+            PersistentHeap heap;
+            EXPECT_FALSE(heap.open(HEAP_PATH, HEAP_CAPACITY * 2, HEAP_BASE));
+            EXPECT_FALSE(heap.isOpen());
+        }
+
+        // The rejected open did not grow the file
+        EXPECT_EQ(fileSize(HEAP_PATH), (long)HEAP_CAPACITY);
+        std::remove(HEAP_PATH);
+    }
+
+    TEST(PersistentHeap, FailedCreateLeavesFileEmpty)
+    {
+        static const char* OTHER_PATH = "persistent_heap_test_other.bin";
+        std::remove(HEAP_PATH);
+        std::remove(OTHER_PATH);
+
+        PersistentHeap heap;
+        ASSERT_TRUE(heap.open(HEAP_PATH, HEAP_CAPACITY, HEAP_BASE));
+
+        // The base is taken by the first heap
+        PersistentHeap other;
+        EXPECT_FALSE(other.open(OTHER_PATH, HEAP_CAPACITY, HEAP_BASE));
+        EXPECT_EQ(fileSize(OTHER_PATH), 0);
+
+        heap.close();
+        std::remove(HEAP_PATH);
+        std::remove(OTHER_PATH);
+    }
+}
@@ -0,0 +1,81 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <SharedHeap.h>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#include <thread>
+#include <vector>
+
+namespace SharedHeap {
+    static void* const HEAP_BASE = (void*)0x210000000000ull;
+    static constexpr uint64 HEAP_CAPACITY = 64ull * 1024 * 1024;
+
+    TEST(SharedHeap, OffsetsRoundTrip)
+    {
+        SharedHeap heap;
+        ASSERT_TRUE(heap.open("SharedHeapTest_Offsets", HEAP_CAPACITY, HEAP_BASE));
+        EXPECT_TRUE(heap.created());
+
+        uint32 sizes[] = { 16, 1000, 1024 * 1024 };
+        for (uint32 size : sizes) {
+            void* p = heap.alloc(size);
+            ASSERT_NE(p, nullptr);
+
+            uint64 offset = heap.toOffset(p);
+            EXPECT_LT(offset, HEAP_CAPACITY);
+            EXPECT_EQ(heap.fromOffset(offset), p);
+            heap.free(p);
+        }
+
+        void* root = heap.alloc(64);
+        heap.setRoot(3, root);
+        EXPECT_EQ(heap.getRoot(3), root);
+        EXPECT_EQ(heap.getRoot(0), nullptr);
+    }
+
+    TEST(SharedHeap, ConcurrentAllocFree)
+    {
+        SharedHeap heap;
+        ASSERT_TRUE(heap.open("SharedHeapTest_Concurrent", HEAP_CAPACITY, HEAP_BASE));
+
+        std::vector<std::thread> threads;
+        for (uint32 t = 0; t < 4; t++) {
+            threads.emplace_back([&heap, t]() {
+                std::vector<uint32*> blocks;
+                for (uint32 i = 0; i < 10000; i++) {
+                    auto* p = (uint32*)heap.alloc(16 + (i * 40) % 4000);
+                    *p = t;
+                    blocks.push_back(p);
+
+                    if (blocks.size() > 100) {
+                        EXPECT_EQ(*blocks.front(), t);
+                        heap.free(blocks.front());
+                        blocks.erase(blocks.begin());
+                    }
+                }
+
+                for (uint32* p : blocks)
+                    heap.free(p);
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    TEST(SharedHeap, AttachGivesUpOnUnfinishedSection)
+    {
+        // Stands in for a creator that died before it set the section up
+        HANDLE stalled = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                            (DWORD)HEAP_CAPACITY, "SharedHeapTest_Stalled");
+        ASSERT_NE(stalled, nullptr);
+
+        SharedHeap heap;
+        EXPECT_FALSE(heap.open("SharedHeapTest_Stalled", HEAP_CAPACITY, HEAP_BASE, 100));
+        EXPECT_FALSE(heap.isOpen());
+        CloseHandle(stalled);
+    }
+}
@@ -0,0 +1,75 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <SnapshotHeap.h>
+
+namespace SnapshotHeap {
+    static void* const HEAP_BASE = (void*)0x220000000000ull;
+    static constexpr uint64 HEAP_CAPACITY = 64ull * 1024 * 1024;
+
+    struct Node {
+        Node* next;
+        uint32 value;
+    };
+
+    TEST(SnapshotHeap, SnapshotKeepsOldValues)
+    {
+        SnapshotHeap heap;
+        ASSERT_TRUE(heap.open(HEAP_CAPACITY, HEAP_BASE));
+        auto& allocator = heap.allocator();
+
+        Node* head = nullptr;
+        for (uint32 i = 0; i < 1000; i++) {
+            auto* node = (Node*)allocator.alloc(sizeof(Node));
+            node->next = head;
+            node->value = i;
+            head = node;
+        }
+        heap.setRoot(0, head);
+
+        ASSERT_TRUE(heap.takeSnapshot());
+
+        // The live heap keeps working at the same addresses
+        EXPECT_EQ(heap.getRoot(0), head);
+        for (Node* node = head; node; node = node->next)
+            node->value += 1000;
+        auto* extra = (Node*)allocator.alloc(sizeof(Node));
+        extra->next = head;
+        extra->value = 5000;
+        heap.setRoot(0, extra);
+
+        auto* snapshotHead = (const Node*)heap.getSnapshotRoot(0);
+        uint32 count = 0;
+        for (const Node* node = snapshotHead; node; node = heap.inSnapshot(node->next)) {
+            EXPECT_EQ(node->value, 999 - count);
+            count++;
+        }
+        EXPECT_EQ(count, 1000);
+
+        EXPECT_TRUE(heap.releaseSnapshot());
+        EXPECT_FALSE(heap.hasSnapshot());
+
+        // Everything written during the snapshot survived the release
+        count = 0;
+        for (Node* node = (Node*)heap.getRoot(0); node; node = node->next)
+            count++;
+        EXPECT_EQ(count, 1001);
+        EXPECT_EQ(head->value, 1999);
+    }
+
+    TEST(SnapshotHeap, RepeatedSnapshots)
+    {
+        SnapshotHeap heap;
+        ASSERT_TRUE(heap.open(HEAP_CAPACITY, HEAP_BASE));
+
+        auto* counter = (uint32*)heap.allocator().alloc(sizeof(uint32));
+        *counter = 0;
+
+        for (uint32 i = 0; i < 5; i++) {
+            ASSERT_TRUE(heap.takeSnapshot());
+            (*counter)++;
+            EXPECT_EQ(*heap.inSnapshot(counter), i);
+            ASSERT_TRUE(heap.releaseSnapshot());
+            EXPECT_EQ(*counter, i + 1);
+        }
+    }
+}
@@ -0,0 +1,169 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <SubHeap.h>
+#include <SubHeapAllocatorT.h>
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace SubHeap {
+    TEST(SubHeap, BudgetLimitsLiveSize)
+    {
+        auto heaps = std::make_unique<SubHeapSet>();
+        heaps->init();
+        SubHeap* heap = heaps->create("meshes", 64 * 1024);
+        ASSERT_NE(heap, nullptr);
+
+        std::vector<void*> blocks;
+        while (void* p = heap->alloc(64))
+            blocks.push_back(p);
+
+        StatReport stat = heap->getStat();
+        EXPECT_EQ(blocks.size(), 1024u);
+        EXPECT_EQ(stat.liveSize, 64 * 1024u);
+        EXPECT_EQ(stat.allocCallCount, 1024u);
+        EXPECT_EQ(stat.overBudgetCount, 1u);
+
+        heap->free(blocks.back(), 64);
+        heap->free(blocks[0]);
+        blocks.pop_back();
+        blocks.erase(blocks.begin());
+        EXPECT_EQ(heap->getStat().liveSize, 64 * 1022u);
+        EXPECT_EQ(heap->getStat().freeCallCount, 2u);
+
+        // Grows in place within the budget, a big block would exceed it
+        void* grown = heap->realloc(heap->alloc(100), 128);
+        EXPECT_NE(grown, nullptr);
+        EXPECT_EQ(heap->realloc(grown, 1024 * 1024), nullptr);
+        EXPECT_EQ(heap->getStat().liveSize, 64 * 1024u);
+
+        heap->setBudget(UNLIMITED);
+        void* big = heap->alloc(1024 * 1024);
+        ASSERT_NE(big, nullptr);
+        EXPECT_EQ(heap->getStat().liveSize, 64 * 1024u + heap->usableSize(big));
+        EXPECT_EQ(heap->getStat().peakSize, heap->getStat().liveSize);
+
+        heap->free(big);
+        heap->free(grown, 128);
+        for (void* p : blocks)
+            heap->free(p, 64);
+        EXPECT_EQ(heap->getStat().liveSize, 0u);
+
+        heaps->destroy();
+    }
+
+    TEST(SubHeap, AlignedBlocksAreAdmittedAtTheirTierSize)
+    {
+        auto heaps = std::make_unique<SubHeapSet>();
+        heaps->init();
+        SubHeap* heap = heaps->create("textures", 1024);
+
+        // 64 bytes aligned to 512 take a 512-byte block
+        void* a = heap->allocAligned(64, 512);
+        void* b = heap->allocAligned(64, 512);
+        ASSERT_NE(a, nullptr);
+        ASSERT_NE(b, nullptr);
+        EXPECT_EQ(heap->allocAligned(64, 512), nullptr);
+        EXPECT_EQ(heap->getStat().liveSize, 1024u);
+        EXPECT_EQ(heap->getStat().overBudgetCount, 1u);
+
+        heap->freeAligned(a, 64, 512);
+        heap->freeAligned(b, 64, 512);
+        EXPECT_EQ(heap->getStat().liveSize, 0u);
+
+        heaps->destroy();
+    }
+
+    TEST(SubHeap, ReleaseAllDropsEveryBlock)
+    {
+        auto heaps = std::make_unique<SubHeapSet>();
+        heaps->init();
+        SubHeap* cache = heaps->create("cache");
+        SubHeap* other = heaps->create("other");
+        uint64 usedBefore = heaps->getUsedSize();
+
+        void* kept = other->alloc(256);
+        for (uint32 i = 0; i < 20000; i++)
+            memset(cache->alloc(16 + i % 3000), 0xAB, 16);
+        void* big = cache->alloc(4 * 1024 * 1024);
+        memset(big, 0xAB, 4 * 1024 * 1024);
+        EXPECT_GT(heaps->getUsedSize(), usedBefore);
+
+        cache->releaseAll();
+        EXPECT_EQ(cache->getStat().liveSize, 0u);
+        EXPECT_EQ(cache->getStat().releaseAllCount, 1u);
+        // Only the first page of every tier is back
+        EXPECT_EQ(heaps->getUsedSize(), usedBefore);
+
+        // Released pages read as zero again
+        auto* fresh = (uint8*)cache->allocZeroed(64);
+        for (uint32 i = 0; i < 64; i++)
+            ASSERT_EQ(fresh[i], 0);
+        auto* medium = (uint8*)cache->allocZeroed(2000);
+        for (uint32 i = 0; i < 2000; i++)
+            ASSERT_EQ(medium[i], 0);
+
+        EXPECT_TRUE(other->owns(kept));
+        EXPECT_EQ(other->getStat().liveSize, 256u);
+
+        heaps->destroy();
+    }
+
+    TEST(SubHeap, NamesAreUnique)
+    {
+        auto heaps = std::make_unique<SubHeapSet>();
+        heaps->init();
+
+        SubHeap* audio = heaps->create("audio", 1024);
+        EXPECT_STREQ(audio->getName(), "audio");
+        EXPECT_EQ(audio->getBudget(), 1024u);
+        EXPECT_EQ(heaps->create("audio"), nullptr);
+        EXPECT_EQ(heaps->create("a name that does not fit into the sub-heap"), nullptr);
+        EXPECT_EQ(heaps->find("audio"), audio);
+        EXPECT_EQ(heaps->find("physics"), nullptr);
+
+        for (uint32 i = 1; i < MAX_SUB_HEAPS; i++)
+            EXPECT_NE(heaps->create(std::to_string(i).c_str()), nullptr);
+        EXPECT_EQ(heaps->create("physics"), nullptr);
+        EXPECT_EQ(heaps->getCount(), MAX_SUB_HEAPS);
+
+        heaps->destroy();
+        EXPECT_EQ(heaps->getCount(), 0u);
+    }
+
+    struct CacheTag {};
+
+    template <typename T>
+    using CacheAllocator = MemoryAllocator::SubHeapAllocatorT<T, CacheTag>;
+    using CacheValue = std::vector<int, CacheAllocator<int>>;
+    using Cache = std::map<int, CacheValue, std::less<>, CacheAllocator<std::pair<const int, CacheValue>>>;
+
+    TEST(SubHeap, ContainersBoundToASubHeap)
+    {
+        using Source = MemoryAllocator::SubHeapSource<CacheTag>;
+        EXPECT_THROW(CacheAllocator<int>{}, std::bad_alloc);
+
+        auto heaps = std::make_unique<SubHeapSet>();
+        heaps->init();
+        Source::allocator = heaps->create("cache", 1024 * 1024);
+
+        // The cache itself lives in the sub-heap, releaseAll is its whole teardown
+        auto* cache = new (Source::allocator->alloc(sizeof(Cache))) Cache();
+        for (int i = 0; i < 1000; i++)
+            (*cache)[i].assign(i % 50, i);
+        EXPECT_EQ((*cache)[999].size(), 49u);
+
+        EXPECT_THROW((*cache)[-1].resize(1024 * 1024), std::bad_alloc);
+        EXPECT_GT(Source::allocator->getStat().liveSize, 1000 * sizeof(Cache::value_type));
+
+        Source::allocator->releaseAll();
+        EXPECT_EQ(Source::allocator->getStat().liveSize, 0u);
+
+        heaps->destroy();
+        Source::allocator = nullptr;
+    }
+}
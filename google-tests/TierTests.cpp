@@ -0,0 +1,48 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <Tier.h>
+
+#include <cstring>
+
+namespace Tier {
+    void CheckTier(Tier& tier, uint32 size) {
+        void* a = tier.alloc(size);
+        void* b = tier.alloc(size);
+        ASSERT_NE(a, nullptr);
+        ASSERT_NE(b, nullptr);
+        EXPECT_EQ((uint64)a % 16, 0u);
+        EXPECT_TRUE(tier.owns(a));
+        EXPECT_TRUE(tier.owns(b));
+        EXPECT_GE(tier.usableSize(a), size);
+        memset(a, 0xFF, size);
+
+        StatReport stat = tier.getStat();
+        EXPECT_EQ(stat.allocCallCount, 2u);
+        EXPECT_EQ(stat.liveSize, tier.usableSize(a) + tier.usableSize(b));
+
+        tier.free(a);
+        tier.free(b);
+        stat = tier.getStat();
+        EXPECT_EQ(stat.freeCallCount, 2u);
+        EXPECT_EQ(stat.liveSize, 0u);
+
+        int local = 0;
+        EXPECT_FALSE(tier.owns(&local));
+    }
+
+    TEST(Tier, BuiltInTiersImplementTheInterface)
+    {
+        FixedSizeTier fixedSizeTier;
+        fixedSizeTier.init(4096);
+        CheckTier(fixedSizeTier, 4096);
+        fixedSizeTier.destroy();
+
+        CoalesceTier coalesceTier;
+        coalesceTier.init();
+        CheckTier(coalesceTier, 10000);
+        coalesceTier.destroy();
+
+        VirtualTier virtualTier;
+        CheckTier(virtualTier, 3u * 1024u * 1024u);
+    }
+}
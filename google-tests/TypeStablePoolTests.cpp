@@ -0,0 +1,121 @@
+#include "lib/googletest/include/gtest/gtest.h"
+
+#include <TypeStablePoolT.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace MemoryAllocator {
+    struct Node {
+        std::atomic<uint64> version;
+        std::atomic<uint64> value;
+    };
+
+    TEST(TypeStablePool, FreedNodeKeepsFields)
+    {
+        TypeStablePoolT<Node> pool;
+        pool.init();
+
+        Node* node = pool.alloc();
+        EXPECT_EQ(node->version.load(), 0u);
+        node->version = 7;
+        node->value = 42;
+        pool.free(node);
+
+        // A stale reader still sees the whole node
+        EXPECT_TRUE(pool.contains(node));
+        EXPECT_EQ(node->version.load(), 7u);
+        EXPECT_EQ(node->value.load(), 42u);
+
+        // Fresh blocks go first, the reused node keeps its version counter
+        std::vector<Node*> fresh;
+        Node* reused;
+        while ((reused = pool.alloc()) != node)
+            fresh.push_back(reused);
+        EXPECT_EQ(reused->version.load(), 7u);
+
+        pool.free(reused);
+        for (Node* p : fresh)
+            pool.free(p);
+        pool.destroy();
+    }
+
+    TEST(TypeStablePool, OptimisticReadersDuringReuse)
+    {
+        TypeStablePoolT<Node> pool;
+        pool.init();
+
+        // Writers recycle nodes with an odd version while updating, readers validate
+        // the version around the read: a consistent read always has value == version / 2
+        constexpr int NODE_COUNT = 64;
+        std::vector<Node*> nodes;
+        for (int i = 0; i < NODE_COUNT; i++)
+            nodes.push_back(pool.alloc());
+
+        std::atomic<bool> stop = false;
+        std::atomic<uint64> badReads = 0;
+        std::vector<Node*> snapshot = nodes;
+
+        std::thread reader([&] {
+            while (!stop) {
+                for (Node* node : snapshot) {
+                    uint64 v1 = node->version.load(std::memory_order_acquire);
+                    uint64 value = node->value.load(std::memory_order_acquire);
+                    uint64 v2 = node->version.load(std::memory_order_acquire);
+                    if (v1 == v2 && (v1 & 1) == 0 && value != v1 / 2)
+                        badReads++;
+                }
+            }
+        });
+
+        for (int round = 0; round < 200; round++) {
+            for (Node*& node : nodes) {
+                pool.free(node);
+                node = pool.alloc();
+                uint64 v = node->version.load();
+                node->version.store(v + 1, std::memory_order_release);
+                node->value.store((v + 2) / 2, std::memory_order_release);
+                node->version.store(v + 2, std::memory_order_release);
+            }
+        }
+
+        stop = true;
+        reader.join();
+        EXPECT_EQ(badReads.load(), 0u);
+
+        for (Node* node : nodes)
+            pool.free(node);
+        pool.destroy();
+    }
+
+    TEST(TypeStablePool, ContainsWhilePagesAreAdded)
+    {
+        TypeStablePoolT<Node> pool;
+        pool.init();
+        Node* first = pool.alloc();
+
+        // The writer keeps appending pages to the list contains walks
+        std::atomic<bool> stop = false;
+        std::atomic<uint64> misses = 0;
+        std::thread reader([&] {
+            while (!stop) {
+                if (!pool.contains(first))
+                    misses++;
+            }
+        });
+
+        std::vector<Node*> nodes;
+        for (int i = 0; i < 100000; i++)
+            nodes.push_back(pool.alloc());
+
+        stop = true;
+        reader.join();
+        EXPECT_EQ(misses.load(), 0u);
+
+        pool.free(first);
+        for (Node* node : nodes)
+            pool.free(node);
+        pool.destroy();
+    }
+}
@@ -12,7 +12,7 @@ namespace BitOps {
         if (!v) return v;
 
 #if defined(_MSC_VER)
-        DWORD idx;
+        unsigned long idx;
         _BitScanReverse(&idx, v);
         return (uint32_t)idx;
 #elif defined(__GNUC__) || defined(__clang__)
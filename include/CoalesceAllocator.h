@@ -2,12 +2,27 @@
 #define COMPOSITE_MEMORY_ALLOCATOR_COALESCEALLOCATOR_H
 
 #include "Types.h"
+#include "PageArena.h"
 
 namespace CoalesceAllocator {
     static constexpr uint32 NUM_BINS = 24;
     static constexpr uint32 PAGE_SIZE = 1u << NUM_BINS; // 16 * 1024 * 1024
     static constexpr uint32 DEADBEEF = 0xdeadbeef;
     static constexpr uint32 FEEDFACE = 0xfeedface;
+    // Every block starts so that its payload is aligned to this
+    static constexpr uint32 ALIGNMENT = 16;
+
+    struct CompactResult {
+        uint32 movedCount = 0;
+        // Memory of free page tails given back to the OS
+        uint64 releasedSize = 0;
+        // The last page was reached, the next call starts over from the first one
+        bool passDone = false;
+    };
+
+    // Compaction asks whether the block behind p may move and reports where it went
+    using CanMoveFunc = bool (*)(void* p, void* context);
+    using MovedFunc = void (*)(void* oldP, void* newP, void* context);
 
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
     struct StatReport {
@@ -34,11 +49,26 @@ namespace CoalesceAllocator {
         CoalesceAllocator(CoalesceAllocator&&) = delete;
         CoalesceAllocator& operator = (CoalesceAllocator&&) = delete;
 
-        void init();
+        // Pages come from the arena when it is given, otherwise from VirtualAlloc
+        void init(PageArena::PageArena* arena = nullptr);
         void destroy();
         void* alloc(uint32 size);
+        void* allocAligned(uint32 size, uint32 align);
+        // Clears only blocks that were used before, untouched page memory is already zero
+        void* allocZeroed(uint32 size);
         void free(void* p);
+        bool resize(void* p, uint32 size);
         bool containsAddress(void* p) const;
+        // Slides up to maxMoves movable blocks down into the free block in front of them, resuming
+        // where the previous call stopped. Only for blocks from alloc, aligned blocks lose their alignment.
+        CompactResult compact(uint32 maxMoves, CanMoveFunc canMove, MovedFunc moved, void* context);
+        // Releases empty pages except the first one and resets the memory of free blocks,
+        // returns the size given back
+        uint64 trim();
+        // Releases every page, live blocks included, and starts over with a fresh one
+        void releaseAll();
+        [[nodiscard]] static uint32 getAllocSize(void* p);
+        [[nodiscard]] static uint32 goodSize(uint32 size);
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
         [[nodiscard]] StatReport getStat() const { return m_StatReport; }
         [[nodiscard]] BlockReport getNextBlock(uint32 pageNum, void* from) const;
@@ -55,6 +85,8 @@ namespace CoalesceAllocator {
             BlockStart* prev;
             uint32 size;
             char alloc;
+            // Free block whose payload was never written (except the debug DEADBEEF)
+            char zeroed;
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
             uint32 markerEnd;
 #endif
@@ -75,13 +107,35 @@ namespace CoalesceAllocator {
             BlockStart* fh[NUM_BINS];
         };
 
+        // A smaller remainder is left inside the allocated block instead of becoming a free block
+        static constexpr uint32 MIN_BLOCK_SIZE = sizeof(BlockStart) + sizeof(BlockEnd);
+
+        Page* findPage(void* p) const;
+
         static uint32 binIndex(uint32 size);
-        static BlockStart* findFreeBlock(const Page* page, uint32 size, uint32& outBinIdx);
-        static Page* createPage(uint32& outBinIdx);
+        static uint32 getBlockSizeFor(uint32 size);
+        static BlockStart* findFreeBlock(const Page* page, uint32 size, uint32 align, uint8*& outPayload);
+        static uint8* alignedPayload(BlockStart* block, uint32 align);
+        void* allocBlock(uint32 size, uint32 align, bool& outZeroed);
+        static void* placeBlock(Page* page, BlockStart* fb, BlockStart* ab, uint32 size, bool& outZeroed);
+        static void pushFreeBlock(Page* page, BlockStart* block, uint32 size, bool zeroed);
+        Page* createPage(uint32& outBinIdx);
+        bool releasePage(Page* page) const;
+        // Leaves no head page
+        void releasePages();
         static bool insidePage(Page* page, void* p) ;
         static void setupBlock(BlockStart *block, uint32 size, BlockStart* next, BlockStart* prev, bool free);
+        static void unlinkBlock(Page* page, BlockStart* block);
+        static void releaseBlock(Page* page, BlockStart* block);
+        static BlockStart* slideBlock(Page* page, BlockStart* fb, BlockStart* ab);
+        static BlockStart* findBlockAt(Page* page, uint32 offset, BlockStart*& outPrev);
+        uint64 resetFreeBlock(BlockStart* block) const;
 
         Page* m_headPage;
+        PageArena::PageArena* m_arena;
+        // Where the next compact call resumes
+        Page* m_compactPage;
+        uint32 m_compactOffset;
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
         StatReport m_StatReport;
 #endif
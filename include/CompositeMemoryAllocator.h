@@ -4,10 +4,28 @@
 
 #include "FixedSizeAllocator.h"
 #include "CoalesceAllocator.h"
+#include "Tier.h"
 
 namespace CompositeMemoryAllocator {
 
-    static constexpr uint32 BLOCK_TYPE_COUNT = 6;
+    static constexpr uint32 VIRTUAL_PAGE_SIZE = 4096u;
+    static constexpr uint32 VIRTUAL_ALLOC_GRANULARITY = 64u * 1024u;
+    // Alignment of every block returned by alloc
+    static constexpr uint32 DEFAULT_ALIGNMENT = CoalesceAllocator::ALIGNMENT;
+    // Keys allocColocated remembers at once, a key probes COLOCATION_PROBE_COUNT slots
+    // and takes over the first one when all of them hold other keys
+    static constexpr uint32 COLOCATION_SLOT_COUNT = 256;
+    static constexpr uint32 COLOCATION_PROBE_COUNT = 4;
+    // Adjacent blocks reserved for a key at a time. They count as used until handed out or
+    // returned: at most COLOCATION_SLOT_COUNT * COLOCATION_RUN_LENGTH blocks, 8MB of 512-byte
+    // blocks by default, which trim hands back before it looks for empty pages
+    static constexpr uint32 COLOCATION_RUN_LENGTH = 64;
+    static constexpr uint64 DEFAULT_RESERVATION_SIZE = 64ull * 1024 * 1024 * 1024;
+    // Size ranges addTier can route to tiers besides the built-in ones
+    static constexpr uint32 MAX_CUSTOM_TIERS = 8;
+    // Above the FSA classes the routing table splits every power of two size range
+    // into 1 << ROUTE_SUB_BITS buckets
+    static constexpr uint32 ROUTE_SUB_BITS = 2;
 
     enum FSABlockSize : uint8 {
         FSA16 = 4,
@@ -18,34 +36,203 @@ namespace CompositeMemoryAllocator {
         FSA512 = 9,
     };
 
-    class CompositeMemoryAllocator {
+    // Compile-time shape of CompositeMemoryAllocatorT. A config defines:
+    //   MIN_FSA_SHIFT    log2 of the smallest FSA class, at least log2(DEFAULT_ALIGNMENT)
+    //   FSA_CLASS_COUNT  power of two FSA classes starting at 1 << MIN_FSA_SHIFT
+    //   USE_COALESCE     false sends everything above the FSA classes to VirtualAlloc
+    //   DEBUG_CHECKS     ownership asserts on the sized free path
+    struct DefaultConfig {
+        static constexpr uint32 MIN_FSA_SHIFT = FSABlockSize::FSA16;
+        static constexpr uint32 FSA_CLASS_COUNT = 6;
+        static constexpr bool USE_COALESCE = true;
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+        static constexpr bool DEBUG_CHECKS = true;
+#else
+        static constexpr bool DEBUG_CHECKS = false;
+#endif
+    };
+
+    // Tier routing is resolved from Config at compile time, a disabled tier costs no branch.
+    // DefaultConfig is instantiated in CompositeMemoryAllocator.cpp, other configs include
+    // CompositeMemoryAllocatorImpl.h
+    template <typename Config>
+    class CompositeMemoryAllocatorT {
     public:
-        CompositeMemoryAllocator() = default;
-        ~CompositeMemoryAllocator() = default;
+        static constexpr uint32 FSA_CLASS_COUNT = Config::FSA_CLASS_COUNT;
+        static constexpr uint32 MAX_FSA_SIZE = 1u << (Config::MIN_FSA_SHIFT + FSA_CLASS_COUNT - 1);
+        // Largest size served below the VirtualAlloc tier
+        static constexpr uint32 MAX_COALESCE_SIZE = Config::USE_COALESCE ? CoalesceAllocator::PAGE_SIZE : MAX_FSA_SIZE;
+        // initReserved splits its range into equal regions: the FSA classes, Coalesce, big blocks
+        static constexpr uint32 REGION_COUNT = FSA_CLASS_COUNT + 2;
+        static constexpr uint32 COALESCE_REGION = FSA_CLASS_COUNT;
+        static constexpr uint32 VIRTUAL_REGION = FSA_CLASS_COUNT + 1;
+        // Routes of the size table: an FSA class, Coalesce, VirtualAlloc or a custom tier.
+        // A built-in route equals the region of its tier
+        static constexpr uint32 COALESCE_ROUTE = COALESCE_REGION;
+        static constexpr uint32 VIRTUAL_ROUTE = VIRTUAL_REGION;
+        static constexpr uint32 CUSTOM_ROUTE = VIRTUAL_REGION + 1;
+        // The routing table has a bucket per DEFAULT_ALIGNMENT step up to MAX_FSA_SIZE,
+        // then ROUTE_SUB_BITS buckets per power of two
+        static constexpr uint32 SMALL_ROUTE_COUNT = (MAX_FSA_SIZE >> Config::MIN_FSA_SHIFT) + 1;
+        static constexpr uint32 LARGE_ROUTE_BASE = (Config::MIN_FSA_SHIFT + FSA_CLASS_COUNT - ROUTE_SUB_BITS) << ROUTE_SUB_BITS;
+        static constexpr uint32 ROUTE_COUNT = SMALL_ROUTE_COUNT + ((33u - ROUTE_SUB_BITS) << ROUTE_SUB_BITS) - LARGE_ROUTE_BASE;
 
-        CompositeMemoryAllocator(const CompositeMemoryAllocator&) = delete;
-        CompositeMemoryAllocator& operator = (const CompositeMemoryAllocator&) = delete;
-        CompositeMemoryAllocator(CompositeMemoryAllocator&&) = delete;
-        CompositeMemoryAllocator& operator = (CompositeMemoryAllocator&&) = delete;
+        static_assert(FSA_CLASS_COUNT >= 1, "CompositeMemoryAllocatorT: at least one FSA class");
+        static_assert((1u << Config::MIN_FSA_SHIFT) >= DEFAULT_ALIGNMENT,
+                      "CompositeMemoryAllocatorT: the smallest class must keep DEFAULT_ALIGNMENT");
+        static_assert(!Config::USE_COALESCE || MAX_FSA_SIZE < CoalesceAllocator::PAGE_SIZE,
+                      "CompositeMemoryAllocatorT: FSA classes must stay below the Coalesce page");
+        static_assert(CUSTOM_ROUTE + MAX_CUSTOM_TIERS <= 256, "CompositeMemoryAllocatorT: routes are stored as uint8");
 
-        void init();
+        CompositeMemoryAllocatorT() = default;
+        ~CompositeMemoryAllocatorT() = default;
+
+        CompositeMemoryAllocatorT(const CompositeMemoryAllocatorT&) = delete;
+        CompositeMemoryAllocatorT& operator = (const CompositeMemoryAllocatorT&) = delete;
+        CompositeMemoryAllocatorT(CompositeMemoryAllocatorT&&) = delete;
+        CompositeMemoryAllocatorT& operator = (CompositeMemoryAllocatorT&&) = delete;
+
+        // With an arena every tier takes its pages from it, see PersistentHeap. Otherwise the
+        // FSA classes and Coalesce share a growable arena, the central page heap, and only
+        // big blocks call VirtualAlloc themselves. policy selects how the FSA tier reuses freed blocks
+        void init(PageArena::PageArena* arena = nullptr,
+                  FixedSizeAllocator::ReusePolicy policy = FixedSizeAllocator::ReusePolicy::Lifo);
+        // Reserves one range of address space and carves every tier's pages out of a region at
+        // a fixed offset, so the tier of a pointer is a shift and owns is a range compare.
+        // capacity is rounded up to REGION_COUNT equal power of two regions. A big block that
+        // does not fit into its region gets a VirtualAlloc reservation of its own
+        bool initReserved(uint64 capacity = DEFAULT_RESERVATION_SIZE,
+                          FixedSizeAllocator::ReusePolicy policy = FixedSizeAllocator::ReusePolicy::Lifo);
         void destroy();
+        // Routes alloc and sized free of minSize..maxSize to tier instead of a built-in tier.
+        // Fails when the range shares a routing bucket with another custom range or all
+        // MAX_CUSTOM_TIERS are taken. Call before the first allocation of a size in the range;
+        // the tier is not owned and, unlike the built-in tiers, does not survive a remapped heap
+        bool addTier(Tier::Tier* tier, uint32 minSize, uint32 maxSize);
         void* alloc(uint32 size);
+        // Skips the memset for memory that is known to be zero
+        void* allocZeroed(uint32 size);
+        // Places an FSA-sized block on the page of hint and close to it when there is room,
+        // e.g. a list node next to its predecessor; other sizes are a plain alloc
+        void* allocNear(uint32 size, const void* hint);
+        // Blocks allocated with the same key (a session, a document) and size class are
+        // handed out in address order from a run reserved for the key; the rest of a run
+        // goes back to the FSA when another key takes over the slot, on trim or on destroy
+        void* allocColocated(uint32 size, uint64 key);
         void free(void *p);
+        // size is the one passed to the last alloc/realloc of p: it selects the tier and
+        // FSA class directly, ownership is only checked in debug builds
+        void free(void *p, uint32 size);
+        // Alignment is kept only while the block is resized in place
+        void* realloc(void *p, uint32 size);
+        // align must be a power of two, the block is released with free.
+        // Over-aligned blocks always come from the built-in tiers
+        void* allocAligned(uint32 size, uint32 align);
+        void freeAligned(void *p, uint32 size, uint32 align);
+        // Reserves maxSize bytes of address space once; grow commits pages in place and never moves the block
+        void* allocGrowable(uint64 maxSize);
+        bool grow(void *p, uint64 size);
+        // Real capacity of the block behind p, may exceed the requested size
+        [[nodiscard]] uint64 usableSize(void *p) const;
+        // size is the one passed to alloc/realloc, as for free(p, size): no search
+        [[nodiscard]] uint64 usableSize(void *p, uint32 size) const;
+        // Capacity alloc(size) would return
+        [[nodiscard]] uint64 goodSize(uint32 size) const;
+        // Capacity allocAligned(size, align) would return, the larger one when it may take two tiers
+        [[nodiscard]] uint64 goodSizeAligned(uint32 size, uint32 align) const;
+        // true when p was returned by this allocator and not freed yet, searches every tier.
+        // With initReserved only the range is compared: a freed block is still owned.
+        // Big blocks that did not fit into their region are still searched for
+        [[nodiscard]] bool owns(void *p) const;
+        [[nodiscard]] bool isReserved() const { return m_reservedBase != nullptr; }
+        // Gives empty FSA and Coalesce pages and free Coalesce memory back to the OS, returns the size.
+        // The page heap decommits its free runs then; a shared arena is left to its owner.
+        // Unused colocation runs are returned first, the next allocColocated of a key starts a new run
+        uint64 trim();
+        // Releases every FSA, Coalesce and big block at once, live ones included, in time
+        // proportional to the pages rather than the blocks. Pointers into them must not be
+        // used or freed afterwards. Blocks of custom tiers are left alone
+        void releaseAll();
+        // The central page heap, unused when init was given an arena
+        [[nodiscard]] const PageArena::PageArena& getPageHeap() const { return m_pageHeap; }
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
         void dumpStat() const;
         void dumpBlocks() const;
 #endif
     private:
-        struct VirtualAllocPage {
+        struct alignas(16) VirtualAllocPage {
             VirtualAllocPage* next;
             VirtualAllocPage* prev;
+            uint64 size;
+            uint64 reserved;
+            // From the start of the reservation, non-zero only for over-aligned blocks
+            uint32 offset;
         };
 
-        FixedSizeAllocator::FixedSizeAllocator m_fixedSizeAllocators[BLOCK_TYPE_COUNT];
+        struct TierRoute {
+            Tier::Tier* tier;
+            uint32 minSize;
+            uint32 maxSize;
+        };
+
+        struct ColocationSlot {
+            uint64 key;
+            uint8* next;
+            uint32 left;
+            uint32 fsaIndex;
+        };
+
+        static uint64 alignUp(uint64 value, uint64 alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+        static constexpr bool isCoalesceSize(uint32 size) { return Config::USE_COALESCE && size <= MAX_COALESCE_SIZE; }
+        static uint32 fsaIndex(uint32 size);
+        static uint32 routeIndex(uint32 size);
+        // Route of size when no custom tier is registered
+        static constexpr uint32 builtinRoute(uint64 size) {
+            if (size <= MAX_FSA_SIZE) {
+                uint32 index = 0;
+                while ((1ull << (Config::MIN_FSA_SHIFT + index)) < size)
+                    index++;
+                return index;
+            }
+            return Config::USE_COALESCE && size <= MAX_COALESCE_SIZE ? COALESCE_ROUTE : VIRTUAL_ROUTE;
+        }
+        static uint64 getUsableSize(const VirtualAllocPage *page);
+        // REGION_COUNT when p is outside the reservation or there is none
+        [[nodiscard]] uint32 regionOf(const void *p) const;
+        [[nodiscard]] bool coalesceContains(const void *p) const {
+            if constexpr (Config::USE_COALESCE)
+                return m_coalesceAllocator.containsAddress((void*)p);
+            else
+                return false;
+        }
+
+        void resetRoutes();
+        [[nodiscard]] uint32 routeOf(uint32 size) const;
+        [[nodiscard]] Tier::Tier* findCustomTier(const void *p) const;
+        void* allocVirtual(uint64 size, uint64 capacity, uint32 align);
+        void freeVirtual(void *p);
+        bool resizeVirtualAllocPage(VirtualAllocPage *page, uint64 size);
+        void* reallocMove(void *p, uint64 oldSize, uint32 size);
+        VirtualAllocPage* findVirtualAllocPage(void *p) const;
+        ColocationSlot& findColocationSlot(uint64 key, uint32 index);
+        void releaseColocationSlot(ColocationSlot& slot);
+
+        FixedSizeAllocator::FixedSizeAllocator m_fixedSizeAllocators[FSA_CLASS_COUNT];
         CoalesceAllocator::CoalesceAllocator m_coalesceAllocator;
         VirtualAllocPage* m_virtualAllocHead = nullptr;
+        PageArena::PageArena* m_arena = nullptr;
+        PageArena::PageArena m_pageHeap;
+        uint8* m_reservedBase = nullptr;
+        uint32 m_regionShift = 0;
+        PageArena::PageArena m_regions[REGION_COUNT];
+        ColocationSlot m_colocationSlots[COLOCATION_SLOT_COUNT] = {};
+        uint8 m_routes[ROUTE_COUNT] = {};
+        TierRoute m_customTiers[MAX_CUSTOM_TIERS] = {};
+        uint32 m_customTierCount = 0;
     };
+
+    using CompositeMemoryAllocator = CompositeMemoryAllocatorT<DefaultConfig>;
+    extern template class CompositeMemoryAllocatorT<DefaultConfig>;
 }
 
 
@@ -0,0 +1,785 @@
+#pragma once
+
+#include "CompositeMemoryAllocator.h"
+#include "BitOps.h"
+#include "DebugAssert.h"
+#include "VirtualMemory.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// Member definitions of CompositeMemoryAllocatorT. DefaultConfig is instantiated once in
+// CompositeMemoryAllocator.cpp, a translation unit using its own config includes this file.
+namespace CompositeMemoryAllocator {
+
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::init(PageArena::PageArena* arena, FixedSizeAllocator::ReusePolicy policy) {
+        m_arena = arena;
+
+        PageArena::PageArena* pageSource = arena;
+        if (pageSource == nullptr) {
+            m_pageHeap.initGrowable();
+            pageSource = &m_pageHeap;
+        }
+
+        for (int i = 0; i < FSA_CLASS_COUNT; ++i) {
+            m_fixedSizeAllocators[i].init(1u << (Config::MIN_FSA_SHIFT + i), pageSource, false, policy);
+        }
+
+        if constexpr (Config::USE_COALESCE)
+            m_coalesceAllocator.init(pageSource);
+
+        resetRoutes();
+    }
+
+    template <typename Config>
+    bool CompositeMemoryAllocatorT<Config>::initReserved(uint64 capacity, FixedSizeAllocator::ReusePolicy policy) {
+        uint32 regionShift = BitOps::log2_floor((uint32)PageArena::SPAN_ALIGNMENT);
+        while (((uint64)REGION_COUNT << regionShift) < capacity)
+            regionShift++;
+
+        uint64 regionSize = 1ull << regionShift;
+        auto* base = (uint8*)VirtualMemory::reserve(regionSize * REGION_COUNT);
+        if (base == nullptr)
+            return false;
+
+        m_arena = nullptr;
+        m_reservedBase = base;
+        m_regionShift = regionShift;
+
+        for (uint32 i = 0; i < REGION_COUNT; ++i)
+            m_regions[i].init(base + i * regionSize, regionSize, true);
+
+        for (uint32 i = 0; i < FSA_CLASS_COUNT; ++i)
+            m_fixedSizeAllocators[i].init(1u << (Config::MIN_FSA_SHIFT + i), &m_regions[i], false, policy);
+
+        if constexpr (Config::USE_COALESCE)
+            m_coalesceAllocator.init(&m_regions[COALESCE_REGION]);
+
+        resetRoutes();
+        return true;
+    }
+
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::destroy() {
+        for (auto & slot : m_colocationSlots)
+            releaseColocationSlot(slot);
+
+        for (auto & m_fixedSizeAllocator : m_fixedSizeAllocators)
+            m_fixedSizeAllocator.destroy();
+
+        if constexpr (Config::USE_COALESCE)
+            m_coalesceAllocator.destroy();
+
+        if (isReserved()) {
+            VirtualMemory::release(m_reservedBase);
+            m_reservedBase = nullptr;
+        }
+        else if (m_arena == nullptr) {
+            m_pageHeap.destroy();
+        }
+
+        CMA_ASSERT(m_virtualAllocHead == nullptr);
+        m_customTierCount = 0;
+    }
+
+    // Every power of two ends a bucket, so all sizes of a bucket share the built-in route
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::resetRoutes() {
+        constexpr uint32 subMask = (1u << ROUTE_SUB_BITS) - 1;
+        for (uint32 i = 0; i < ROUTE_COUNT; ++i) {
+            uint64 upper = (uint64)i << Config::MIN_FSA_SHIFT;
+            if (i >= SMALL_ROUTE_COUNT) {
+                uint32 bucket = i - SMALL_ROUTE_COUNT + LARGE_ROUTE_BASE;
+                uint32 msb = (bucket >> ROUTE_SUB_BITS) + ROUTE_SUB_BITS - 1;
+                upper = (1ull << msb) + ((uint64)((bucket & subMask) + 1) << (msb - ROUTE_SUB_BITS));
+            }
+            m_routes[i] = (uint8)builtinRoute(upper);
+        }
+        m_customTierCount = 0;
+    }
+
+    template <typename Config>
+    bool CompositeMemoryAllocatorT<Config>::addTier(Tier::Tier* tier, uint32 minSize, uint32 maxSize) {
+        CMA_ASSERT(tier != nullptr && minSize <= maxSize);
+        if (m_customTierCount == MAX_CUSTOM_TIERS)
+            return false;
+
+        uint32 first = routeIndex(minSize);
+        uint32 last = routeIndex(maxSize);
+        for (uint32 i = first; i <= last; ++i) {
+            if (m_routes[i] >= CUSTOM_ROUTE)
+                return false;
+        }
+
+        auto route = (uint8)(CUSTOM_ROUTE + m_customTierCount);
+        m_customTiers[m_customTierCount++] = { tier, minSize, maxSize };
+        for (uint32 i = first; i <= last; ++i)
+            m_routes[i] = route;
+        return true;
+    }
+
+    // A bucket only partly covered by a custom range keeps the built-in route for the rest
+    template <typename Config>
+    __forceinline uint32 CompositeMemoryAllocatorT<Config>::routeOf(uint32 size) const {
+        uint32 route = m_routes[routeIndex(size)];
+        if (route >= CUSTOM_ROUTE) {
+            const TierRoute& custom = m_customTiers[route - CUSTOM_ROUTE];
+            if (size < custom.minSize || size > custom.maxSize)
+                return builtinRoute(size);
+        }
+        return route;
+    }
+
+    template <typename Config>
+    Tier::Tier* CompositeMemoryAllocatorT<Config>::findCustomTier(const void *p) const {
+        for (uint32 i = 0; i < m_customTierCount; ++i) {
+            if (m_customTiers[i].tier->owns(p))
+                return m_customTiers[i].tier;
+        }
+        return nullptr;
+    }
+
+    template <typename Config>
+    void* CompositeMemoryAllocatorT<Config>::alloc(uint32 size) {
+        uint32 route = routeOf(size);
+        if (route < FSA_CLASS_COUNT) {
+            return m_fixedSizeAllocators[route].alloc(size);
+        }
+        else if (Config::USE_COALESCE && route == COALESCE_ROUTE) {
+            return m_coalesceAllocator.alloc(size);
+        }
+        else if (route == VIRTUAL_ROUTE) {
+            // Reserve twice the size, so realloc can grow the block
+            // by committing more pages instead of moving it. Arena pages
+            // are always backed, so there the headroom would be wasted.
+            return allocVirtual(size, m_arena ? size : 2 * (uint64)size, DEFAULT_ALIGNMENT);
+        }
+        else {
+            return m_customTiers[route - CUSTOM_ROUTE].tier->alloc(size);
+        }
+    }
+
+    template <typename Config>
+    void* CompositeMemoryAllocatorT<Config>::allocZeroed(uint32 size) {
+        uint32 route = routeOf(size);
+        if (route < FSA_CLASS_COUNT)
+            return m_fixedSizeAllocators[route].allocZeroed(size);
+
+        if (Config::USE_COALESCE && route == COALESCE_ROUTE)
+            return m_coalesceAllocator.allocZeroed(size);
+
+        void* p = alloc(size);
+        // Freshly committed pages are zero, a custom tier gives no such guarantee
+        if (p != nullptr && route >= CUSTOM_ROUTE)
+            memset(p, 0, size);
+        return p;
+    }
+
+    template <typename Config>
+    void* CompositeMemoryAllocatorT<Config>::allocNear(uint32 size, const void* hint) {
+        uint32 route = routeOf(size);
+        if (route < FSA_CLASS_COUNT && hint != nullptr)
+            return m_fixedSizeAllocators[route].allocNear(size, hint);
+
+        return alloc(size);
+    }
+
+    // Blocks are not tracked per key: a run gives adjacency, it is not a separate heap
+    template <typename Config>
+    void* CompositeMemoryAllocatorT<Config>::allocColocated(uint32 size, uint64 key) {
+        uint32 index = routeOf(size);
+        if (size == 0 || index >= FSA_CLASS_COUNT)
+            return alloc(size);
+
+        ColocationSlot& slot = findColocationSlot(key, index);
+
+        if (slot.left == 0 || slot.key != key || slot.fsaIndex != index) {
+            releaseColocationSlot(slot);
+
+            FixedSizeAllocator::FixedSizeAllocator& fsa = m_fixedSizeAllocators[index];
+            auto* run = (uint8*)fsa.allocRun(COLOCATION_RUN_LENGTH);
+            if (run == nullptr)
+                return alloc(size);
+
+            slot = { key, run, COLOCATION_RUN_LENGTH, index };
+        }
+
+        void* p = slot.next;
+        slot.next += m_fixedSizeAllocators[index].getBlockSize();
+        slot.left--;
+        return p;
+    }
+
+    // The key's own slot, else a drained one, else the first probed slot is evicted
+    template <typename Config>
+    typename CompositeMemoryAllocatorT<Config>::ColocationSlot& CompositeMemoryAllocatorT<Config>::findColocationSlot(uint64 key, uint32 index) {
+        uint64 hash = (key ^ index) * 0x9E3779B97F4A7C15ull;
+        uint32 first = (uint32)(hash >> 32) % COLOCATION_SLOT_COUNT;
+        ColocationSlot* drained = nullptr;
+
+        for (uint32 i = 0; i < COLOCATION_PROBE_COUNT; i++) {
+            ColocationSlot& slot = m_colocationSlots[(first + i) % COLOCATION_SLOT_COUNT];
+            if (slot.key == key && slot.fsaIndex == index)
+                return slot;
+
+            if (slot.left == 0 && drained == nullptr)
+                drained = &slot;
+        }
+
+        return drained != nullptr ? *drained : m_colocationSlots[first];
+    }
+
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::releaseColocationSlot(ColocationSlot& slot) {
+        FixedSizeAllocator::FixedSizeAllocator& fsa = m_fixedSizeAllocators[slot.fsaIndex];
+        for (; slot.left > 0; slot.left--) {
+            fsa.free(slot.next);
+            slot.next += fsa.getBlockSize();
+        }
+    }
+
+    template <typename Config>
+    void* CompositeMemoryAllocatorT<Config>::allocAligned(uint32 size, uint32 align) {
+        CMA_ASSERT(align != 0 && (align & (align - 1)) == 0);
+
+        if (align <= DEFAULT_ALIGNMENT)
+            return alloc(size);
+
+        // FSA blocks are aligned to their size
+        if (size <= MAX_FSA_SIZE && align <= MAX_FSA_SIZE) {
+            uint32 blockSize = std::max(size, align);
+            return m_fixedSizeAllocators[fsaIndex(blockSize)].alloc(blockSize);
+        }
+
+        if (isCoalesceSize(size) && align <= VIRTUAL_PAGE_SIZE) {
+            if (void* p = m_coalesceAllocator.allocAligned(size, align))
+                return p;
+        }
+
+        return allocVirtual(size, m_arena ? size : 2 * (uint64)size, align);
+    }
+
+    template <typename Config>
+    void* CompositeMemoryAllocatorT<Config>::allocGrowable(uint64 maxSize) {
+        return allocVirtual(0, maxSize, DEFAULT_ALIGNMENT);
+    }
+
+    template <typename Config>
+    bool CompositeMemoryAllocatorT<Config>::grow(void *p, uint64 size) {
+        VirtualAllocPage* page = findVirtualAllocPage(p);
+        if (page == nullptr) {
+            CMA_ASSERT(false);
+            return false;
+        }
+
+        return resizeVirtualAllocPage(page, size);
+    }
+
+    //  ↓(base)                    ↓(page)            ↓(payload, aligned)
+    // [....offset, not committed....][VirtualAllocPage][.....size.....][.....reserved.....]
+    template <typename Config>
+    void* CompositeMemoryAllocatorT<Config>::allocVirtual(uint64 size, uint64 capacity, uint32 align) {
+        CMA_ASSERT(size <= capacity);
+
+        // The reservation is only VIRTUAL_ALLOC_GRANULARITY aligned, bigger alignments need extra room
+        uint64 padding = align > DEFAULT_ALIGNMENT ? align : 0;
+        // A capacity close to 2^64 would wrap the reservation size around to a small one
+        if (capacity > UINT64_MAX - padding - sizeof(VirtualAllocPage) - VIRTUAL_ALLOC_GRANULARITY)
+            return nullptr;
+
+        uint64 reserved = alignUp(padding + sizeof(VirtualAllocPage) + capacity,
+                                  m_arena ? VIRTUAL_PAGE_SIZE : VIRTUAL_ALLOC_GRANULARITY);
+
+        // A region of the reservation is handed out uncommitted, as VirtualAlloc reserves it.
+        // A block the region has no room for gets a reservation of its own
+        uint8* base = nullptr;
+        if (m_arena)
+            base = (uint8*)m_arena->allocPages(reserved);
+        else if (isReserved())
+            base = (uint8*)m_regions[VIRTUAL_REGION].allocPages(reserved, false);
+        if (base == nullptr && !m_arena)
+            base = (uint8*)VirtualMemory::reserve(reserved);
+        if (base == nullptr)
+            return nullptr;
+
+        uint64 payload = alignUp((uint64)base + sizeof(VirtualAllocPage), std::max(align, DEFAULT_ALIGNMENT));
+        auto offset = (uint32)(payload - sizeof(VirtualAllocPage) - (uint64)base);
+        uint64 commitStart = offset & ~(uint64)(VIRTUAL_PAGE_SIZE - 1);
+        uint64 committed = alignUp(offset + sizeof(VirtualAllocPage) + size, VIRTUAL_PAGE_SIZE);
+
+        // Arena pages are handed out committed
+        if (!m_arena && !VirtualMemory::commit(base + commitStart, committed - commitStart)) {
+            if (regionOf(base) == VIRTUAL_REGION)
+                m_regions[VIRTUAL_REGION].freePages(base, reserved, true);
+            else
+                VirtualMemory::release(base);
+            return nullptr;
+        }
+
+        auto* page = (VirtualAllocPage*)(base + offset);
+        page->size = size;
+        page->reserved = reserved;
+        page->offset = offset;
+        page->next = m_virtualAllocHead;
+        if (page->next) page->next->prev = page;
+        page->prev = nullptr;
+        m_virtualAllocHead = page;
+        return (uint8*)page + sizeof(VirtualAllocPage);
+    }
+
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::free(void *p) {
+        uint32 region = regionOf(p);
+        if (region < FSA_CLASS_COUNT) {
+            m_fixedSizeAllocators[region].free(p);
+            return;
+        }
+
+        if (region == COALESCE_REGION) {
+            m_coalesceAllocator.free(p);
+            return;
+        }
+
+        if (region == VIRTUAL_REGION) {
+            freeVirtual(p);
+            return;
+        }
+
+        for (auto &fsa : m_fixedSizeAllocators) {
+            if (fsa.containsAddress(p)) {
+                fsa.free(p);
+                return;
+            }
+        }
+
+        if (coalesceContains(p)) {
+            m_coalesceAllocator.free(p);
+            return;
+        }
+
+        if (Tier::Tier* tier = findCustomTier(p)) {
+            tier->free(p);
+            return;
+        }
+
+        freeVirtual(p);
+    }
+
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::free(void *p, uint32 size) {
+        uint32 route = routeOf(size);
+        if (route < FSA_CLASS_COUNT) {
+            FixedSizeAllocator::FixedSizeAllocator& fsa = m_fixedSizeAllocators[route];
+            if constexpr (Config::DEBUG_CHECKS)
+                CMA_ASSERT(fsa.containsAddress(p));
+            fsa.free(p);
+        }
+        else if (Config::USE_COALESCE && route == COALESCE_ROUTE) {
+            m_coalesceAllocator.free(p);
+        }
+        else if (route == VIRTUAL_ROUTE) {
+            freeVirtual(p);
+        }
+        else {
+            Tier::Tier* tier = m_customTiers[route - CUSTOM_ROUTE].tier;
+            if constexpr (Config::DEBUG_CHECKS)
+                CMA_ASSERT(tier->owns(p));
+            tier->free(p);
+        }
+    }
+
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::freeAligned(void *p, uint32 size, uint32 align) {
+        if (align <= DEFAULT_ALIGNMENT) {
+            free(p, size);
+        }
+        else if (size <= MAX_FSA_SIZE && align <= MAX_FSA_SIZE) {
+            m_fixedSizeAllocators[fsaIndex(std::max(size, align))].free(p);
+        }
+        // allocAligned falls back to a direct allocation when the alignment doesn't fit into a Coalesce page
+        else if (isCoalesceSize(size) && coalesceContains(p)) {
+            m_coalesceAllocator.free(p);
+        }
+        else {
+            freeVirtual(p);
+        }
+    }
+
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::freeVirtual(void *p) {
+        VirtualAllocPage* page = findVirtualAllocPage(p);
+        if (page == nullptr) {
+            CMA_ASSERT(false);
+            return;
+        }
+
+        if (page->next) page->next->prev = page->prev;
+        if (page->prev) page->prev->next = page->next;
+        else m_virtualAllocHead = page->next;
+
+        // Decommitted right away, like a reservation of its own is released
+        if (m_arena)
+            m_arena->freePages((uint8*)page - page->offset, page->reserved, true);
+        else if (regionOf((uint8*)page - page->offset) == VIRTUAL_REGION)
+            m_regions[VIRTUAL_REGION].freePages((uint8*)page - page->offset, page->reserved, true);
+        else
+            VirtualMemory::release((uint8*)page - page->offset);
+    }
+
+    template <typename Config>
+    void* CompositeMemoryAllocatorT<Config>::realloc(void *p, uint32 size) {
+        if (p == nullptr)
+            return alloc(size);
+
+        if (size == 0) {
+            free(p);
+            return nullptr;
+        }
+
+        // A block stays in place only while the new size maps to the same tier and
+        // FSA class, so it can still be released with free(p, size)
+        uint32 route = routeOf(size);
+        for (auto &fsa : m_fixedSizeAllocators) {
+            if (fsa.containsAddress(p)) {
+                if (route == (uint32)(&fsa - m_fixedSizeAllocators))
+                    return p;
+
+                return reallocMove(p, fsa.getBlockSize(), size);
+            }
+        }
+
+        if (coalesceContains(p)) {
+            if (route == COALESCE_ROUTE && m_coalesceAllocator.resize(p, size))
+                return p;
+
+            return reallocMove(p, CoalesceAllocator::CoalesceAllocator::getAllocSize(p), size);
+        }
+
+        if (Tier::Tier* tier = findCustomTier(p)) {
+            uint64 capacity = tier->usableSize(p);
+            if (route >= CUSTOM_ROUTE && m_customTiers[route - CUSTOM_ROUTE].tier == tier && size <= capacity)
+                return p;
+
+            return reallocMove(p, capacity, size);
+        }
+
+        VirtualAllocPage* page = findVirtualAllocPage(p);
+        if (page == nullptr) {
+            CMA_ASSERT(false);
+            return nullptr;
+        }
+
+        if (route == VIRTUAL_ROUTE && resizeVirtualAllocPage(page, size))
+            return p;
+
+        return reallocMove(p, getUsableSize(page), size);
+    }
+
+    template <typename Config>
+    uint64 CompositeMemoryAllocatorT<Config>::usableSize(void *p) const {
+        uint32 region = regionOf(p);
+        if (region < FSA_CLASS_COUNT)
+            return m_fixedSizeAllocators[region].getBlockSize();
+
+        if (region == COALESCE_REGION)
+            return CoalesceAllocator::CoalesceAllocator::getAllocSize(p);
+
+        for (auto &fsa : m_fixedSizeAllocators) {
+            if (fsa.containsAddress(p))
+                return fsa.getBlockSize();
+        }
+
+        if (coalesceContains(p))
+            return CoalesceAllocator::CoalesceAllocator::getAllocSize(p);
+
+        if (Tier::Tier* tier = findCustomTier(p))
+            return tier->usableSize(p);
+
+        VirtualAllocPage* page = findVirtualAllocPage(p);
+        if (page == nullptr) {
+            CMA_ASSERT(false);
+            return 0;
+        }
+
+        return getUsableSize(page);
+    }
+
+    // A big block's header sits right in front of it
+    template <typename Config>
+    uint64 CompositeMemoryAllocatorT<Config>::usableSize(void *p, uint32 size) const {
+        uint32 route = routeOf(size);
+        if (route < FSA_CLASS_COUNT)
+            return m_fixedSizeAllocators[route].getBlockSize();
+
+        if (Config::USE_COALESCE && route == COALESCE_ROUTE)
+            return CoalesceAllocator::CoalesceAllocator::getAllocSize(p);
+
+        if (route == VIRTUAL_ROUTE)
+            return getUsableSize((VirtualAllocPage*)((uint8*)p - sizeof(VirtualAllocPage)));
+
+        return m_customTiers[route - CUSTOM_ROUTE].tier->usableSize(p);
+    }
+
+    template <typename Config>
+    uint64 CompositeMemoryAllocatorT<Config>::goodSize(uint32 size) const {
+        uint32 route = routeOf(size);
+        if (route < FSA_CLASS_COUNT)
+            return m_fixedSizeAllocators[route].getBlockSize();
+
+        if (Config::USE_COALESCE && route == COALESCE_ROUTE)
+            return CoalesceAllocator::CoalesceAllocator::goodSize(size);
+
+        // A custom tier only reports the capacity of a block it handed out
+        if (route >= CUSTOM_ROUTE)
+            return size;
+
+        return alignUp(sizeof(VirtualAllocPage) + (uint64)size, VIRTUAL_PAGE_SIZE) - sizeof(VirtualAllocPage);
+    }
+
+    // Follows the tier choice of allocAligned. A big block's header is padded to the alignment
+    template <typename Config>
+    uint64 CompositeMemoryAllocatorT<Config>::goodSizeAligned(uint32 size, uint32 align) const {
+        if (align <= DEFAULT_ALIGNMENT)
+            return goodSize(size);
+
+        if (size <= MAX_FSA_SIZE && align <= MAX_FSA_SIZE)
+            return m_fixedSizeAllocators[fsaIndex(std::max(size, align))].getBlockSize();
+
+        uint64 header = alignUp(sizeof(VirtualAllocPage), align);
+        uint64 virtualSize = alignUp(header + size, VIRTUAL_PAGE_SIZE) - header;
+        // A Coalesce page without room for the alignment falls back to a big block
+        if (isCoalesceSize(size) && align <= VIRTUAL_PAGE_SIZE)
+            return std::max<uint64>(CoalesceAllocator::CoalesceAllocator::goodSize(size), virtualSize);
+
+        return virtualSize;
+    }
+
+    // [offset][VirtualAllocPage][.....size.....][..committed tail..][......reserved......]
+    template <typename Config>
+    bool CompositeMemoryAllocatorT<Config>::resizeVirtualAllocPage(VirtualAllocPage *page, uint64 size) {
+        uint8* base = (uint8*)page - page->offset;
+        uint64 committed = alignUp(page->offset + sizeof(VirtualAllocPage) + page->size, VIRTUAL_PAGE_SIZE);
+        uint64 needed = alignUp(page->offset + sizeof(VirtualAllocPage) + size, VIRTUAL_PAGE_SIZE);
+
+        if (needed > page->reserved)
+            return false;
+
+        if (m_arena) {
+            // The whole range is committed, only a regrown tail has to read as zero
+            if (needed > committed)
+                memset(base + committed, 0, needed - committed);
+        }
+        else if (needed > committed) {
+            if (!VirtualMemory::commit(base + committed, needed - committed))
+                return false;
+        }
+        else if (needed < committed) {
+            VirtualMemory::decommit(base + needed, committed - needed);
+        }
+
+        page->size = size;
+        return true;
+    }
+
+    template <typename Config>
+    bool CompositeMemoryAllocatorT<Config>::owns(void *p) const {
+        if (isReserved()) {
+            uint32 region = regionOf(p);
+            if (region < REGION_COUNT)
+                return m_regions[region].containsAddress(p);
+
+            return findCustomTier(p) != nullptr || findVirtualAllocPage(p) != nullptr;
+        }
+
+        for (auto &fsa : m_fixedSizeAllocators) {
+            if (fsa.containsAddress(p))
+                return true;
+        }
+
+        return coalesceContains(p) || findCustomTier(p) != nullptr || findVirtualAllocPage(p) != nullptr;
+    }
+
+    template <typename Config>
+    uint64 CompositeMemoryAllocatorT<Config>::trim() {
+        for (auto &slot : m_colocationSlots)
+            releaseColocationSlot(slot);
+
+        uint64 released = 0;
+        for (auto &fsa : m_fixedSizeAllocators)
+            released += fsa.trim();
+
+        if constexpr (Config::USE_COALESCE)
+            released += m_coalesceAllocator.trim();
+
+        for (uint32 i = 0; i < m_customTierCount; ++i)
+            released += m_customTiers[i].tier->trim();
+
+        // The pages released above are still committed, a shared arena is trimmed by its owner
+        if (isReserved()) {
+            for (auto &region : m_regions)
+                region.trim();
+        }
+        else if (m_arena == nullptr) {
+            m_pageHeap.trim();
+        }
+
+        return released;
+    }
+
+    // Colocation runs point into the released pages, they are dropped without a free
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::releaseAll() {
+        for (auto &slot : m_colocationSlots)
+            slot = {};
+
+        while (m_virtualAllocHead)
+            freeVirtual((uint8*)m_virtualAllocHead + sizeof(VirtualAllocPage));
+
+        for (auto &fsa : m_fixedSizeAllocators)
+            fsa.releaseAll();
+
+        if constexpr (Config::USE_COALESCE)
+            m_coalesceAllocator.releaseAll();
+    }
+
+    template <typename Config>
+    void* CompositeMemoryAllocatorT<Config>::reallocMove(void *p, uint64 oldSize, uint32 size) {
+        void* np = alloc(size);
+        if (np == nullptr)
+            return nullptr;
+
+        memcpy(np, p, std::min<uint64>(oldSize, size));
+        free(p);
+        return np;
+    }
+
+    template <typename Config>
+    uint32 CompositeMemoryAllocatorT<Config>::regionOf(const void *p) const {
+        uint64 offset = (const uint8*)p - m_reservedBase;
+        if (!isReserved() || offset >= (uint64)REGION_COUNT << m_regionShift)
+            return REGION_COUNT;
+
+        return (uint32)(offset >> m_regionShift);
+    }
+
+    template <typename Config>
+    uint32 CompositeMemoryAllocatorT<Config>::fsaIndex(uint32 size) {
+        return BitOps::msb_index((size - 1) >> (Config::MIN_FSA_SHIFT - 1));
+    }
+
+    // FSA sizes index the table directly, larger ones share a bucket with the sizes of the
+    // same power of two and the same next ROUTE_SUB_BITS bits
+    template <typename Config>
+    __forceinline uint32 CompositeMemoryAllocatorT<Config>::routeIndex(uint32 size) {
+        if (size <= MAX_FSA_SIZE)
+            return (size + (1u << Config::MIN_FSA_SHIFT) - 1) >> Config::MIN_FSA_SHIFT;
+
+        constexpr uint32 subMask = (1u << ROUTE_SUB_BITS) - 1;
+        uint32 v = size - 1;
+        uint32 msb = BitOps::msb_index(v);
+        uint32 bucket = ((msb - ROUTE_SUB_BITS + 1) << ROUTE_SUB_BITS) | ((v >> (msb - ROUTE_SUB_BITS)) & subMask);
+        return bucket - LARGE_ROUTE_BASE + SMALL_ROUTE_COUNT;
+    }
+
+    template <typename Config>
+    uint64 CompositeMemoryAllocatorT<Config>::getUsableSize(const VirtualAllocPage *page) {
+        return alignUp(page->offset + sizeof(VirtualAllocPage) + page->size, VIRTUAL_PAGE_SIZE) - page->offset - sizeof(VirtualAllocPage);
+    }
+
+    template <typename Config>
+    typename CompositeMemoryAllocatorT<Config>::VirtualAllocPage* CompositeMemoryAllocatorT<Config>::findVirtualAllocPage(void *p) const {
+        VirtualAllocPage* page = m_virtualAllocHead;
+        while (page) {
+            if ((uint8*)page + sizeof(VirtualAllocPage) == (uint8*)p)
+                return page;
+            page = page->next;
+        }
+        return nullptr;
+    }
+
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::dumpStat() const {
+        printf("----------------[DUMP STAT REPORT]----------------\n");
+        for (auto &fsa : m_fixedSizeAllocators) {
+            printf("----------(FSA %d stat report)----------\n", fsa.getBlockSize());
+            FixedSizeAllocator::StatReport fsaStat = fsa.getStatReport();
+            printf("Pages: %u\tFree blocks: %u\t Alloc calls: %llu\t Free calls: %llu\n",
+                   fsaStat.pagesCount, fsaStat.freeBlockCount, fsaStat.allocCallCount, fsaStat.freeCallCount);
+            printf("----------------------------------------------\n");
+        }
+
+        if constexpr (Config::USE_COALESCE) {
+            CoalesceAllocator::StatReport coalesceStat = m_coalesceAllocator.getStat();
+            printf("---------(Coalesce stat report)---------\n");
+            printf("Pages: %u\tTotal alloc size: %llu\tAlloc calls: %llu\t Free calls: %llu\n",
+                   coalesceStat.pagesCount, coalesceStat.totalAllocSize, coalesceStat.allocCallCount, coalesceStat.freeCallCount);
+            printf("----------------------------------------------\n");
+        }
+
+        uint32 virtualAllocPages = 0;
+        uint64 virtualAllocSize = 0;
+        uint64 virtualAllocReserved = 0;
+        VirtualAllocPage* page = m_virtualAllocHead;
+        while (page) {
+            virtualAllocPages++;
+            virtualAllocSize += page->size;
+            virtualAllocReserved += page->reserved;
+            page = page->next;
+        }
+
+        printf("---------(Virtual Alloc stat report)--------\n");
+        printf("Pages: %u\tTotal alloc size: %llu\tReserved: %llu\n", virtualAllocPages, virtualAllocSize, virtualAllocReserved);
+        printf("----------------------------------------------\n");
+
+        for (uint32 i = 0; i < m_customTierCount; ++i) {
+            const TierRoute& custom = m_customTiers[i];
+            Tier::StatReport tierStat = custom.tier->getStat();
+            printf("-------(Tier %u..%u stat report)-------\n", custom.minSize, custom.maxSize);
+            printf("Live size: %llu\tAlloc calls: %llu\t Free calls: %llu\n",
+                   tierStat.liveSize, tierStat.allocCallCount, tierStat.freeCallCount);
+            printf("----------------------------------------------\n");
+        }
+        printf("-------------[END DUMP STAT REPORT]---------------\n");
+    }
+
+    template <typename Config>
+    void CompositeMemoryAllocatorT<Config>::dumpBlocks() const {
+        printf("-------------[DUMP ALLOC BLOCKS REPORT]-------------\n");
+        for (auto &fsa : m_fixedSizeAllocators) {
+            printf("--------(FSA %d alloc blocks report)--------\n", fsa.getBlockSize());
+            uint32 pages = fsa.getStatReport().pagesCount;
+            for (int i = 0; i < pages; ++i) {
+                FixedSizeAllocator::AllocBlocksReport fsaBlocks = fsa.getAllocBlocksReport(i);
+                printf("Page %u, alloc count: %u\n", i, fsaBlocks.count);
+                for (int j = 0; j < fsaBlocks.count; ++j) {
+                    printf("\t%p\n", fsaBlocks.blocks[j]);
+                }
+            }
+            printf("----------------------------------------------\n");
+        }
+
+        if constexpr (Config::USE_COALESCE) {
+            printf("------------(Coalesce alloc blocks report)------------\n");
+            uint32 coalescePages = m_coalesceAllocator.getStat().pagesCount;
+            for (int i = 0; i < coalescePages; ++i) {
+                printf("Page: %u\n", i);
+                CoalesceAllocator::BlockReport report{};
+                uint32 count = 0;
+                while ((report = m_coalesceAllocator.getNextBlock(i, report.address)).address) {
+                    if (report.allocated) {
+                        printf("\t%p\tsize: %u\n", report.address, report.size);
+                        count++;
+                    }
+                }
+                printf("Total count on page %u: %u\n", i, count);
+            }
+            printf("----------------------------------------------\n");
+        }
+        printf("-----------[END DUMP ALLOC BLOCKS REPORT]-----------\n");
+    }
+
+#endif
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "CompressedHeap.h"
+#include "MemoryAllocatorT.h"
+
+namespace MemoryAllocator {
+    struct CompressedHeapSingleton {
+        inline static std::unique_ptr<CompressedHeap::CompressedHeap> heap = nullptr;
+        inline static CompositeMemoryAllocator::CompositeMemoryAllocator* allocator = nullptr;
+
+        static void init() {
+            if (!heap)
+            {
+                auto newHeap = std::make_unique<CompressedHeap::CompressedHeap>();
+                if (!newHeap->init())
+                    throw std::bad_alloc{};
+
+                heap = std::move(newHeap);
+                allocator = &heap->allocator();
+            }
+        }
+    };
+
+    // Containers whose elements can be referenced with CompressedPtr
+    template <typename T>
+    using CompressedAllocatorT = MemoryAllocatorT<T, CompressedHeapSingleton>;
+}
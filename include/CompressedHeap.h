@@ -0,0 +1,75 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_COMPRESSEDHEAP_H
+#define COMPOSITE_MEMORY_ALLOCATOR_COMPRESSEDHEAP_H
+
+#include "CompositeMemoryAllocator.h"
+
+#include <cstddef>
+
+namespace CompressedHeap {
+    // Offsets are stored in units of 8 bytes, so 32 bits cover 32GB
+    static constexpr uint32 OFFSET_SHIFT = 3;
+    static constexpr uint64 MAX_CAPACITY = ((uint64)UINT32_MAX + 1) << OFFSET_SHIFT;
+
+    // CompositeMemoryAllocator whose tiers all take their pages from one reserved range, so
+    // every block can be addressed by a 32-bit CompressedPtr. Pages are committed on demand.
+    // Only one heap can be initialized at a time: CompressedPtr decodes against its base.
+    class CompressedHeap {
+    public:
+        CompressedHeap() = default;
+        ~CompressedHeap();
+
+        CompressedHeap(const CompressedHeap&) = delete;
+        CompressedHeap& operator = (const CompressedHeap&) = delete;
+        CompressedHeap(CompressedHeap&&) = delete;
+        CompressedHeap& operator = (CompressedHeap&&) = delete;
+
+        bool init(uint64 capacity = MAX_CAPACITY);
+        void destroy();
+
+        [[nodiscard]] CompositeMemoryAllocator::CompositeMemoryAllocator& allocator() { return m_allocator; }
+        [[nodiscard]] static uint8* getBase() { return s_base; }
+
+    private:
+        inline static uint8* s_base = nullptr;
+
+        PageArena::PageArena m_arena;
+        CompositeMemoryAllocator::CompositeMemoryAllocator m_allocator;
+    };
+
+    // Pointer into the initialized CompressedHeap stored as a 32-bit scaled offset from its base.
+    // The first page of the range is never handed out, offset 0 is nullptr.
+    template <typename T>
+    class CompressedPtr {
+    public:
+        CompressedPtr() = default;
+        CompressedPtr(std::nullptr_t) {}
+        CompressedPtr(T* p) : m_offset(encode(p)) {}
+
+        CompressedPtr& operator = (T* p) { m_offset = encode(p); return *this; }
+        CompressedPtr& operator = (std::nullptr_t) { m_offset = 0; return *this; }
+
+        [[nodiscard]] T* get() const {
+            return m_offset ? (T*)(CompressedHeap::getBase() + ((uint64)m_offset << OFFSET_SHIFT)) : nullptr;
+        }
+
+        T* operator -> () const { return get(); }
+        T& operator * () const { return *get(); }
+        explicit operator bool () const { return m_offset != 0; }
+        operator T* () const { return get(); }
+
+        bool operator == (const CompressedPtr& rhs) const { return m_offset == rhs.m_offset; }
+        bool operator != (const CompressedPtr& rhs) const { return m_offset != rhs.m_offset; }
+
+        [[nodiscard]] uint32 getOffset() const { return m_offset; }
+
+    private:
+        static uint32 encode(T* p) {
+            return p ? (uint32)(((uint8*)p - CompressedHeap::getBase()) >> OFFSET_SHIFT) : 0;
+        }
+
+        uint32 m_offset = 0;
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_COMPRESSEDHEAP_H
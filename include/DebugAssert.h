@@ -0,0 +1,14 @@
+#pragma once
+
+// ASSERT of Common.h for public headers, prefixed so it does not clash with client macros
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+
+#include <cassert>
+
+#define CMA_ASSERT(x) assert(x)
+
+#else
+
+#define CMA_ASSERT(x)               do {} while(0)
+
+#endif
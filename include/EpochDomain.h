@@ -0,0 +1,109 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_EPOCHDOMAIN_H
+#define COMPOSITE_MEMORY_ALLOCATOR_EPOCHDOMAIN_H
+
+#include "CompositeMemoryAllocator.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace EpochDomain {
+    static constexpr uint32 MAX_THREAD_COUNT = 64;
+    // A thread tries to advance the epoch and reclaim after this many retires
+    static constexpr uint32 BATCH_SIZE = 64;
+    static constexpr uint32 CHUNK_CAPACITY = 256;
+
+    struct StatReport {
+        uint64 retiredCount = 0;
+        uint64 reclaimedCount = 0;
+    };
+
+    // Epoch-based deferred reclamation for lock-free structures on top of a
+    // CompositeMemoryAllocator. Readers wrap accesses in enter/exit, writers retire
+    // unlinked blocks instead of freeing them. A block retired in epoch e is returned
+    // to its tier once the global epoch reaches e + 2: by then every thread has left
+    // the critical sections that could still see it. Blocks are freed per thread in
+    // batches, one allocator lock per batch.
+    class EpochDomain {
+    public:
+        struct ThreadRecord;
+
+        EpochDomain() = default;
+        ~EpochDomain() = default;
+
+        EpochDomain(const EpochDomain&) = delete;
+        EpochDomain& operator = (const EpochDomain&) = delete;
+        EpochDomain(EpochDomain&&) = delete;
+        EpochDomain& operator = (EpochDomain&&) = delete;
+
+        // allocatorLock guards every other use of allocator, may be nullptr when there is none
+        void init(CompositeMemoryAllocator::CompositeMemoryAllocator* allocator, std::mutex* allocatorLock);
+        // No thread may be registered anymore, everything still retired is freed
+        void destroy();
+
+        ThreadRecord* registerThread();
+        void unregisterThread(ThreadRecord* record);
+        void enter(ThreadRecord* record);
+        void exit(ThreadRecord* record);
+        // size 0 frees without a size, see CompositeMemoryAllocator::free
+        void retire(ThreadRecord* record, void* p, uint32 size = 0);
+        // Advances as far as the other threads allow and frees what became safe
+        void flush(ThreadRecord* record);
+        [[nodiscard]] StatReport getStat() const;
+
+    private:
+        struct Retired {
+            void* p;
+            uint32 size;
+        };
+
+        struct Chunk {
+            Chunk* next;
+            uint32 count;
+            Retired entries[CHUNK_CAPACITY];
+        };
+
+        struct Bucket {
+            Chunk* head = nullptr;
+            uint64 epoch = 0;
+        };
+
+    public:
+        struct alignas(64) ThreadRecord {
+            // (epoch << 1) | 1 inside a critical section, 0 outside
+            std::atomic<uint64> state{ 0 };
+            std::atomic<bool> used{ false };
+            Bucket buckets[3];
+            uint32 sinceScan = 0;
+        };
+
+    private:
+        bool tryAdvance();
+        void reclaim(ThreadRecord* record);
+        void freeBucket(Bucket& bucket);
+        bool push(Bucket& bucket, void* p, uint32 size);
+
+        CompositeMemoryAllocator::CompositeMemoryAllocator* m_allocator = nullptr;
+        std::mutex* m_allocatorLock = nullptr;
+        std::atomic<uint64> m_epoch{ 1 };
+        std::atomic<uint64> m_retiredCount{ 0 };
+        std::atomic<uint64> m_reclaimedCount{ 0 };
+        ThreadRecord m_records[MAX_THREAD_COUNT];
+    };
+
+    // Critical section for the lifetime of the guard
+    class EpochGuard {
+    public:
+        EpochGuard(EpochDomain& domain, EpochDomain::ThreadRecord* record) : m_domain(domain), m_record(record) { m_domain.enter(m_record); }
+        ~EpochGuard() { m_domain.exit(m_record); }
+
+        EpochGuard(const EpochGuard&) = delete;
+        EpochGuard& operator = (const EpochGuard&) = delete;
+
+    private:
+        EpochDomain& m_domain;
+        EpochDomain::ThreadRecord* m_record;
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_EPOCHDOMAIN_H
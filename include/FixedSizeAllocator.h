@@ -2,10 +2,28 @@
 #define COMPOSITE_MEMORY_ALLOCATOR_FIXEDSIZEALLOCATOR_H
 
 #include "Types.h"
+#include "PageArena.h"
 
 namespace FixedSizeAllocator {
 
     static constexpr uint32 PAGE_SIZE = 4096u;
+    static constexpr uint32 MAX_NATURAL_ALIGNMENT = 4096u;
+    // Free blocks allocNear compares against the fresh one before picking the closest
+    static constexpr uint32 NEAR_SCAN_LIMIT = 64u;
+
+    // Which free block alloc hands out next. free finds the page by address under every policy
+    enum class ReusePolicy : uint8 {
+        // The page's last freed block, never used blocks come first: warm in cache.
+        // free is O(1) once the page is found
+        Lifo,
+        // The lowest free address of the first page with room: keeps live blocks packed.
+        // free keeps the page's free list sorted, O(free blocks of the page)
+        AddressOrdered,
+        // The lowest free address of the page with the most live blocks, so sparse
+        // pages drain and trim can release them. The page is cached and only searched
+        // for again, O(pages), when it fills up; free is sorted as for AddressOrdered
+        FullestPage,
+    };
 
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
     struct StatReport {
@@ -31,12 +49,33 @@ namespace FixedSizeAllocator {
         FixedSizeAllocator(FixedSizeAllocator&&) = delete;
         FixedSizeAllocator& operator = (FixedSizeAllocator&&) = delete;
 
-        void init(uint32 blockSize);
+        // Pages come from the arena when it is given, otherwise from VirtualAlloc.
+        // A type-stable allocator keeps every page mapped until destroy and stores the
+        // free-list link in the last word of a block, so a freed block keeps its first
+        // word and stays readable as the same type by optimistic lock-free readers
+        void init(uint32 blockSize, PageArena::PageArena* arena = nullptr, bool typeStable = false,
+                  ReusePolicy policy = ReusePolicy::Lifo);
         void destroy();
         void* alloc(uint32 size);
+        // Clears only blocks reused from the free list
+        void* allocZeroed(uint32 size);
+        // Takes the block closest to hint from the page holding hint, falls back to alloc
+        // when hint is not in this allocator or its page is full
+        void* allocNear(uint32 size, const void* hint);
+        // count adjacent zeroed blocks from the never used tail of a page, or from a new page.
+        // Each block is released with free on its own, count is at most PAGE_SIZE
+        void* allocRun(uint32 count);
         void free(void *p);
         [[nodiscard]] uint32 getBlockSize() const;
         bool containsAddress(void* p) const;
+        // Releases pages without live blocks except the first one, returns the released size.
+        // Does nothing for a type-stable allocator
+        uint64 trim();
+        // Releases every page, live blocks included, and starts over with a fresh one.
+        // Not for a type-stable allocator: its pages must stay mapped until destroy
+        void releaseAll();
+        [[nodiscard]] bool isTypeStable() const;
+        [[nodiscard]] ReusePolicy getReusePolicy() const;
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
         [[nodiscard]] StatReport getStatReport() const;
         [[nodiscard]] AllocBlocksReport getAllocBlocksReport(uint32 pageNum) const;
@@ -47,15 +86,31 @@ namespace FixedSizeAllocator {
             Page *next;
             int numInit;
             int fh;
+            int numUsed;
         };
         struct Block {
             int freeIndex;
         };
 
+        void* allocBlock(uint32 size, bool& outZeroed);
+        void* takeBlock(Page* page, bool& outZeroed) const;
+        [[nodiscard]] Page *findFullestPage() const;
+        [[nodiscard]] Block* getBlock(Page* page, int index) const;
+        [[nodiscard]] Page *findPage(const void* p) const;
         [[nodiscard]] Page *createPage() const;
+        bool releasePage(Page* page) const;
+        // Leaves no head page
+        void releasePages();
+        [[nodiscard]] uint32 getPageSize() const;
 
         Page *m_headPage;
+        // FullestPage: where alloc takes blocks from, nullptr until the next search
+        Page *m_fullestPage;
         uint32 m_blockSize;
+        uint32 m_dataOffset;
+        uint32 m_linkOffset;
+        ReusePolicy m_reusePolicy;
+        PageArena::PageArena* m_arena;
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
         StatReport m_StatReport;
 #endif
@@ -0,0 +1,49 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_GLOBALALLOCATOR_H
+#define COMPOSITE_MEMORY_ALLOCATOR_GLOBALALLOCATOR_H
+
+#include "CompositeMemoryAllocator.h"
+
+namespace GlobalAllocator {
+
+    // The process-wide CompositeMemoryAllocator behind one lock, for callers that cannot
+    // own an instance (MemoryAllocatorT, the cma_* C API, global operator new). It is created
+    // on first use from zeroed static storage, so it works before static constructors ran,
+    // and is never destroyed. It runs in single-reservation mode, so unsized free finds the
+    // tier by address. Sizes above 4GB are served as growable blocks.
+    class GlobalAllocator {
+    public:
+        // The only instance, its address is a constant
+        static GlobalAllocator instance;
+
+        GlobalAllocator(const GlobalAllocator&) = delete;
+        GlobalAllocator& operator = (const GlobalAllocator&) = delete;
+        GlobalAllocator(GlobalAllocator&&) = delete;
+        GlobalAllocator& operator = (GlobalAllocator&&) = delete;
+
+        void* alloc(uint64 size);
+        void* allocZeroed(uint64 size);
+        void* allocNear(uint64 size, const void* hint);
+        // align must be a power of two, the block is released with free or freeAligned
+        void* allocAligned(uint64 size, uint64 align);
+        void free(void* p);
+        // size is the one passed to alloc/realloc: selects the size class without a search
+        void free(void* p, uint64 size);
+        void freeAligned(void* p, uint64 size, uint64 align);
+        void* realloc(void* p, uint64 size);
+        void* allocGrowable(uint64 maxSize);
+        bool grow(void* p, uint64 size);
+        [[nodiscard]] uint64 usableSize(void* p);
+        [[nodiscard]] uint64 goodSize(uint64 size);
+        [[nodiscard]] bool owns(void* p);
+        uint64 trim();
+
+    private:
+        constexpr GlobalAllocator() = default;
+
+        static CompositeMemoryAllocator::CompositeMemoryAllocator& composite();
+        static void* allocLarge(uint64 size);
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_GLOBALALLOCATOR_H
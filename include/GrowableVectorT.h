@@ -0,0 +1,114 @@
+#pragma once
+
+#include "MemoryAllocatorT.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace MemoryAllocator {
+    // Vector over a block from GlobalAllocator::allocGrowable: the whole
+    // maxCount range is reserved up front, so growing never moves or copies
+    // elements and pointers to them stay valid until destruction.
+    template <typename T>
+    class GrowableVectorT {
+    public:
+        using value_type = T;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        explicit GrowableVectorT(std::size_t maxCount) :
+            m_maxCount(maxCount)
+        {
+            if (maxCount > SIZE_MAX / sizeof(T))
+                throw std::length_error("GrowableVectorT: maxCount * sizeof(T) overflows");
+
+            m_data = static_cast<T*>(GlobalAllocatorSource::allocator->allocGrowable(maxCount * sizeof(T)));
+
+            if (!m_data)
+                throw std::bad_alloc{};
+        }
+
+        ~GrowableVectorT()
+        {
+            if (!m_data)
+                return;
+
+            clear();
+            GlobalAllocatorSource::allocator->free(m_data);
+        }
+
+        GrowableVectorT(const GrowableVectorT&) = delete;
+        GrowableVectorT& operator = (const GrowableVectorT&) = delete;
+
+        GrowableVectorT(GrowableVectorT&& other) noexcept :
+            m_data(std::exchange(other.m_data, nullptr)),
+            m_size(std::exchange(other.m_size, 0)),
+            m_capacity(std::exchange(other.m_capacity, 0)),
+            m_maxCount(std::exchange(other.m_maxCount, 0))
+        {
+        }
+
+        GrowableVectorT& operator = (GrowableVectorT&&) = delete;
+
+        void reserve(std::size_t n) {
+            if (n <= m_capacity)
+                return;
+
+            if (n > m_maxCount)
+                throw std::length_error("GrowableVectorT: reserve exceeds max_size");
+
+            if (!GlobalAllocatorSource::allocator->grow(m_data, n * sizeof(T)))
+                throw std::bad_alloc{};
+
+            m_capacity = n;
+        }
+
+        void push_back(const T& value) { emplace_back(value); }
+        void push_back(T&& value) { emplace_back(std::move(value)); }
+
+        template <typename... Args>
+        T& emplace_back(Args&&... args) {
+            if (m_size == m_capacity)
+                reserve(std::max(m_size + 1, std::min(m_maxCount, m_capacity * 2)));
+
+            T* p = new (m_data + m_size) T(std::forward<Args>(args)...);
+            m_size++;
+            return *p;
+        }
+
+        void pop_back() {
+            m_data[--m_size].~T();
+        }
+
+        void clear() {
+            while (m_size)
+                pop_back();
+        }
+
+        T& operator [] (std::size_t i) { return m_data[i]; }
+        const T& operator [] (std::size_t i) const { return m_data[i]; }
+        T& back() { return m_data[m_size - 1]; }
+        const T& back() const { return m_data[m_size - 1]; }
+
+        T* data() { return m_data; }
+        const T* data() const { return m_data; }
+        iterator begin() { return m_data; }
+        iterator end() { return m_data + m_size; }
+        const_iterator begin() const { return m_data; }
+        const_iterator end() const { return m_data + m_size; }
+
+        [[nodiscard]] bool empty() const { return m_size == 0; }
+        [[nodiscard]] std::size_t size() const { return m_size; }
+        [[nodiscard]] std::size_t capacity() const { return m_capacity; }
+        [[nodiscard]] std::size_t max_size() const { return m_maxCount; }
+
+    private:
+        T* m_data = nullptr;
+        std::size_t m_size = 0;
+        std::size_t m_capacity = 0;
+        std::size_t m_maxCount = 0;
+    };
+}
@@ -0,0 +1,59 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_HANDLEHEAP_H
+#define COMPOSITE_MEMORY_ALLOCATOR_HANDLEHEAP_H
+
+#include "CoalesceAllocator.h"
+
+namespace HandleHeap {
+    using Handle = uint32;
+    static constexpr Handle INVALID_HANDLE = 0;
+    static constexpr uint32 MAX_HANDLE_COUNT = 1u << 24;
+
+    // Relocatable blocks addressed through an indirection table. Blocks live in their own
+    // CoalesceAllocator pages, so compact can slide every unpinned block towards the page
+    // start and give the free tails back, which raw pointers would prevent.
+    class HandleHeap {
+    public:
+        HandleHeap() = default;
+        ~HandleHeap();
+
+        HandleHeap(const HandleHeap&) = delete;
+        HandleHeap& operator = (const HandleHeap&) = delete;
+        HandleHeap(HandleHeap&&) = delete;
+        HandleHeap& operator = (HandleHeap&&) = delete;
+
+        void init();
+        void destroy();
+        Handle allocHandle(uint32 size);
+        void freeHandle(Handle handle);
+        // The pointer stays valid until the matching unpin, pins nest
+        void* pin(Handle handle);
+        void unpin(Handle handle);
+        // Moves at most maxMoves blocks, call repeatedly (e.g. once per frame or request)
+        CoalesceAllocator::CompactResult compact(uint32 maxMoves);
+
+    private:
+        // Stored in front of every block, so compaction can find the owning handle
+        struct alignas(CoalesceAllocator::ALIGNMENT) BlockHeader {
+            Handle handle;
+        };
+
+        struct Entry {
+            void* block;
+            uint32 pinCount;
+            // Next free entry while this one is unused
+            Handle nextFree;
+        };
+
+        static bool canMove(void* p, void* context);
+        static void moved(void* oldP, void* newP, void* context);
+
+        CoalesceAllocator::CoalesceAllocator m_allocator;
+        Entry* m_entries = nullptr;
+        uint32 m_entryCount = 0;
+        uint32 m_committedCount = 0;
+        Handle m_freeHead = INVALID_HANDLE;
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_HANDLEHEAP_H
@@ -0,0 +1,74 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_LIFETIMEHEAP_H
+#define COMPOSITE_MEMORY_ALLOCATOR_LIFETIMEHEAP_H
+
+#include "CompositeMemoryAllocator.h"
+
+namespace LifetimeHeap {
+    enum class Lifetime : uint8 {
+        Short,
+        Long,
+    };
+
+    static constexpr uint32 LIFETIME_COUNT = 2;
+    // Every SAMPLE_PERIOD-th allocation from a site is tracked until it is freed
+    static constexpr uint32 SAMPLE_PERIOD = 64;
+    static constexpr uint32 SAMPLE_SLOT_COUNT = 4096;
+    static constexpr uint32 SITE_SLOT_COUNT = 1024;
+    // Sites whose samples live for fewer allocations than this on average are short-lived
+    static constexpr uint64 SHORT_LIFETIME = 16 * 1024;
+    static constexpr uint32 MIN_SAMPLES = 4;
+
+    // Keeps short- and long-lived blocks in separate CompositeMemoryAllocators, so one
+    // surviving object does not pin a page of temporaries. The lifetime is either given
+    // explicitly or predicted per allocation site from sampled lifetimes, where a site is
+    // any stable address identifying the caller (e.g. a static in the calling function).
+    // Lifetimes are measured in allocations made through this heap.
+    class LifetimeHeap {
+    public:
+        LifetimeHeap() = default;
+        ~LifetimeHeap() = default;
+
+        LifetimeHeap(const LifetimeHeap&) = delete;
+        LifetimeHeap& operator = (const LifetimeHeap&) = delete;
+        LifetimeHeap(LifetimeHeap&&) = delete;
+        LifetimeHeap& operator = (LifetimeHeap&&) = delete;
+
+        void init();
+        void destroy();
+        void* alloc(uint32 size, Lifetime lifetime);
+        void* allocAt(uint32 size, const void* site);
+        void free(void* p);
+        // Sites without enough samples are predicted long-lived, the layout of the default heap
+        [[nodiscard]] Lifetime predict(const void* site) const;
+        // Short-lived pages empty out together, trimming them is cheap
+        uint64 trim(Lifetime lifetime);
+        [[nodiscard]] CompositeMemoryAllocator::CompositeMemoryAllocator& allocator(Lifetime lifetime);
+
+    private:
+        struct Site {
+            const void* key;
+            uint64 avgLifetime;
+            uint32 samples;
+            uint32 allocCount;
+        };
+
+        struct Sample {
+            void* p;
+            Site* site;
+            uint64 birth;
+        };
+
+        // Adds the site when it is not tracked yet
+        Site* findSite(const void* site);
+        static Lifetime classify(const Site* site);
+        static uint32 hash(const void* p, uint32 slotCount);
+
+        CompositeMemoryAllocator::CompositeMemoryAllocator m_allocators[LIFETIME_COUNT];
+        Site m_sites[SITE_SLOT_COUNT] = {};
+        Sample m_samples[SAMPLE_SLOT_COUNT] = {};
+        uint64 m_tick = 0;
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_LIFETIMEHEAP_H
@@ -0,0 +1,39 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_MALLOCAPI_H
+#define COMPOSITE_MEMORY_ALLOCATOR_MALLOCAPI_H
+
+#include <stddef.h>
+
+// C interface to the process-wide allocator (GlobalAllocator). Thread-safe.
+// Semantics follow the C library functions of the same name:
+// blocks are DEFAULT_ALIGNMENT aligned, cma_free(NULL) does nothing, cma_realloc(p, 0)
+// frees p and returns NULL
+
+#if defined(_WIN32) && defined(CMA_SHARED_EXPORTS)
+#define CMA_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(CMA_SHARED)
+#define CMA_API __declspec(dllimport)
+#elif defined(__GNUC__)
+#define CMA_API __attribute__((visibility("default")))
+#else
+#define CMA_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+CMA_API void* cma_malloc(size_t size);
+CMA_API void cma_free(void* p);
+CMA_API void* cma_realloc(void* p, size_t size);
+// NULL when count * size overflows
+CMA_API void* cma_calloc(size_t count, size_t size);
+// align must be a power of two
+CMA_API void* cma_memalign(size_t align, size_t size);
+CMA_API size_t cma_malloc_usable_size(void* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_MALLOCAPI_H
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MEMOPS_SSE2
+#endif
+
+namespace MemOps {
+
+    // Below this size the block is likely to be used right away, so it is cleared
+    // through the cache; above it streaming stores avoid evicting the working set
+    static constexpr size_t NON_TEMPORAL_THRESHOLD = 256 * 1024;
+
+    inline void zero(void* p, size_t size)
+    {
+#if defined(MEMOPS_SSE2)
+        if (size >= NON_TEMPORAL_THRESHOLD) {
+            auto* dst = (uint8_t*)p;
+            size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+            memset(dst, 0, head);
+            dst += head;
+            size -= head;
+
+            const __m128i z = _mm_setzero_si128();
+            for (size_t i = size / 64; i > 0; --i, dst += 64) {
+                _mm_stream_si128((__m128i*)dst, z);
+                _mm_stream_si128((__m128i*)(dst + 16), z);
+                _mm_stream_si128((__m128i*)(dst + 32), z);
+                _mm_stream_si128((__m128i*)(dst + 48), z);
+            }
+            _mm_sfence();
+
+            memset(dst, 0, size & 63);
+            return;
+        }
+#endif
+        memset(p, 0, size);
+    }
+
+}
@@ -1,62 +1,158 @@
 #pragma once
 
 #include "CompositeMemoryAllocator.h"
+#include "GlobalAllocator.h"
 
 #include <memory>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
 
 namespace MemoryAllocator {
-    struct CompositeMemoryAllocatorSingleton {
-        inline static std::unique_ptr<CompositeMemoryAllocator::CompositeMemoryAllocator> allocator = nullptr;
-
-        static void init() {
-            if (!allocator)
-            {
-                allocator = std::make_unique<CompositeMemoryAllocator::CompositeMemoryAllocator>();
-                allocator->init();
-            }
-        }
+#if defined(__cpp_lib_allocate_at_least)
+    template <typename Pointer>
+    using allocation_result = std::allocation_result<Pointer>;
+#else
+    template <typename Pointer>
+    struct allocation_result {
+        Pointer ptr;
+        std::size_t count;
+    };
+#endif
+
+    // The process-wide GlobalAllocator: thread-safe, and usable from static initializers
+    struct GlobalAllocatorSource {
+        inline static GlobalAllocator::GlobalAllocator* const allocator = &GlobalAllocator::GlobalAllocator::instance;
+
+        static void init() {}
     };
 
-    template <typename T>
+    // Source provides init() and an allocator pointer to the CompositeMemoryAllocator
+    // (or an allocator with the same interface) to use
+    template <typename T, typename Source = GlobalAllocatorSource>
     struct MemoryAllocatorT {
         using value_type = T;
+        // All instances share the Source, so memory can be freed by any of them
+        using is_always_equal = std::true_type;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
 
         MemoryAllocatorT()
         {
-            CompositeMemoryAllocatorSingleton::init();
+            Source::init();
         }
 
         ~MemoryAllocatorT() = default;
 
+        MemoryAllocatorT(const MemoryAllocatorT&) noexcept = default;
+        MemoryAllocatorT(MemoryAllocatorT&&) noexcept = default;
+        MemoryAllocatorT& operator = (const MemoryAllocatorT&) noexcept = default;
+        MemoryAllocatorT& operator = (MemoryAllocatorT&&) noexcept = default;
+
         template <typename U>
-        MemoryAllocatorT(const MemoryAllocatorT<U>& other) noexcept
+        MemoryAllocatorT(const MemoryAllocatorT<U, Source>& other) noexcept
         {
         }
 
         template <typename U>
-        MemoryAllocatorT(MemoryAllocatorT<U>&& other)
+        MemoryAllocatorT(MemoryAllocatorT<U, Source>&& other)
         {
         }
 
         template <typename U>
-        MemoryAllocatorT& operator = (const MemoryAllocatorT<U>& rhs) = delete;
+        MemoryAllocatorT& operator = (const MemoryAllocatorT<U, Source>& rhs) = delete;
         template <typename U>
-        MemoryAllocatorT& operator = (MemoryAllocatorT<U>&& lhs) = delete;
+        MemoryAllocatorT& operator = (MemoryAllocatorT<U, Source>&& lhs) = delete;
 
         T* allocate(std::size_t n) {
-            if (auto p = CompositeMemoryAllocatorSingleton::allocator->alloc(n * sizeof(T)))
+            if (auto p = allocateBytes(byteSize(n)))
+                return static_cast<T*>(p);
+
+            throw std::bad_alloc{};
+        }
+
+        // Returns the whole block: count is the number of T that fit into it, count >= n
+        allocation_result<T*> allocate_at_least(std::size_t n) {
+            uint64 good = Source::allocator->goodSize(byteSize(n));
+            auto size = (SizeType)std::min<uint64>(good, std::numeric_limits<SizeType>::max());
+            if (auto p = allocateBytes(size))
+                return { static_cast<T*>(p), (std::size_t)(size / sizeof(T)) };
+
+            throw std::bad_alloc{};
+        }
+
+        // For node-based structures: places the new node close to hint, e.g. its parent or predecessor
+        T* allocate_near(std::size_t n, const void* hint) {
+            void* p = OVER_ALIGNED
+                ? allocateBytes(byteSize(n))
+                : Source::allocator->allocNear(byteSize(n), hint);
+            if (p)
                 return static_cast<T*>(p);
 
             throw std::bad_alloc{};
         }
 
-        void deallocate(T* p, std::size_t) {
-            CompositeMemoryAllocatorSingleton::allocator->free(p);
+        void deallocate(T* p, std::size_t n) {
+            if constexpr (OVER_ALIGNED)
+                Source::allocator->freeAligned(p, (SizeType)(n * sizeof(T)), alignof(T));
+            else
+                Source::allocator->free(p, (SizeType)(n * sizeof(T)));
+        }
+
+        // Only for trivially copyable T: the block is moved with memcpy when it can't be resized in place
+        T* reallocate(T* p, std::size_t oldN, std::size_t n) {
+            // realloc keeps only the default alignment when the block moves
+            if constexpr (OVER_ALIGNED) {
+                T* np = n ? allocate(n) : nullptr;
+                if (p) {
+                    if (np) memcpy(np, p, std::min(oldN, n) * sizeof(T));
+                    deallocate(p, oldN);
+                }
+                return np;
+            }
+
+            if (auto np = Source::allocator->realloc(p, byteSize(n)))
+                return static_cast<T*>(np);
+
+            if (n == 0)
+                return nullptr;
+
+            throw std::bad_alloc{};
         }
 
         template <typename U>
         struct rebind {
-            using other = MemoryAllocatorT<U>;
+            using other = MemoryAllocatorT<U, Source>;
         };
+
+        template <typename U>
+        bool operator == (const MemoryAllocatorT<U, Source>&) const noexcept { return true; }
+        template <typename U>
+        bool operator != (const MemoryAllocatorT<U, Source>&) const noexcept { return false; }
+
+    private:
+        static constexpr bool OVER_ALIGNED = alignof(T) > CompositeMemoryAllocator::DEFAULT_ALIGNMENT;
+
+        template <typename Allocator, typename Size>
+        static Size sizeParameter(void* (Allocator::*)(Size));
+        // uint32 for CompositeMemoryAllocator, uint64 for GlobalAllocator
+        using SizeType = decltype(sizeParameter(&std::remove_pointer_t<decltype(Source::allocator)>::alloc));
+
+        // Throws instead of passing on a size the Source would truncate
+        static SizeType byteSize(std::size_t n) {
+            if (n > std::numeric_limits<SizeType>::max() / sizeof(T))
+                throw std::bad_array_new_length{};
+
+            return (SizeType)(n * sizeof(T));
+        }
+
+        static void* allocateBytes(SizeType size) {
+            if constexpr (OVER_ALIGNED)
+                return Source::allocator->allocAligned(size, alignof(T));
+            else
+                return Source::allocator->alloc(size);
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_PAGEARENA_H
+#define COMPOSITE_MEMORY_ALLOCATOR_PAGEARENA_H
+
+#include "Types.h"
+
+namespace PageArena {
+    static constexpr uint32 PAGE_SIZE = 4096u;
+    // Address space a growable arena reserves from the OS at once
+    static constexpr uint64 DEFAULT_SPAN_SIZE = 64ull * 1024 * 1024;
+    static constexpr uint64 SPAN_ALIGNMENT = 64ull * 1024;
+
+    // Hands out page runs from one contiguous address range instead of calling VirtualAlloc
+    // for each of them. It keeps no pointers outside the range and has no virtual functions,
+    // so it can live inside the memory it manages (e.g. a file mapping).
+    // A growable arena is the central page heap of CompositeMemoryAllocator instead: it
+    // reserves spans from the OS as it runs out, and a run freed by one tier or size class
+    // can be handed to any other one.
+    // A freed run stays committed as dirty and is cleared when handed out again, only trim
+    // decommits it. Free runs are found first fit, in O(free ranges) of each list.
+    class PageArena {
+    public:
+        PageArena() = default;
+        ~PageArena() = default;
+
+        PageArena(const PageArena&) = delete;
+        PageArena& operator = (const PageArena&) = delete;
+        PageArena(PageArena&&) = delete;
+        PageArena& operator = (PageArena&&) = delete;
+
+        // commitOnDemand: the range is only reserved, pages are committed when handed out
+        void init(void* base, uint64 capacity, bool commitOnDemand);
+        // Commits on demand too, spans are reserved in spanSize steps or as big as a request needs
+        void initGrowable(uint64 spanSize = DEFAULT_SPAN_SIZE);
+        // Releases the spans of a growable arena
+        void destroy();
+        // commit = false is for commit-on-demand arenas whose caller commits the run itself,
+        // it only takes runs that are not committed
+        void* allocPages(uint64 size, bool commit = true);
+        // decommit is for runs the caller committed only in part, e.g. a big block
+        void freePages(void* p, uint64 size, bool decommit = false);
+        // Decommits the dirty runs of a commit-on-demand arena and releases the spans of a
+        // growable one that have no pages in use. Returns the size given back to the OS
+        uint64 trim();
+        [[nodiscard]] bool containsAddress(const void* p) const;
+        [[nodiscard]] uint8* getBase() const { return m_base; }
+        // Reserved size of all spans for a growable arena
+        [[nodiscard]] uint64 getCapacity() const { return m_capacity; }
+        [[nodiscard]] uint64 getUsedSize() const { return m_used; }
+        // Nothing at or above this offset has ever been handed out
+        [[nodiscard]] uint64 getHighWaterMark() const { return m_top; }
+        [[nodiscard]] bool isCommitOnDemand() const { return m_commitOnDemand; }
+        [[nodiscard]] bool isGrowable() const { return m_spanSize != 0; }
+        [[nodiscard]] uint32 getSpanCount() const;
+
+    private:
+        // Stored in the first bytes of a released range, sorted by address. A dirty range is
+        // committed, a zeroed one only in its first page and reads as zero past the header
+        struct FreeRange {
+            FreeRange* next;
+            uint64 size;
+        };
+
+        // In the first page of a span, which is never handed out: it also keeps free
+        // ranges of adjacent spans from merging across the reservation boundary
+        struct Span {
+            Span* next;
+            uint64 size;
+        };
+
+        bool addSpan(uint64 minSize);
+        static FreeRange* findFreeRange(FreeRange* head, uint64 size, FreeRange*& outPrev);
+        void takeFreeRange(FreeRange*& head, FreeRange* prev, FreeRange* range, uint64 size);
+        static void insertFreeRange(FreeRange*& head, FreeRange* range, uint64 size);
+        static uint64 decommitRange(FreeRange* range, uint64 size);
+
+        uint8* m_base = nullptr;
+        uint64 m_capacity = 0;
+        uint64 m_top = 0;
+        uint64 m_used = 0;
+        FreeRange* m_zeroedHead = nullptr;
+        FreeRange* m_dirtyHead = nullptr;
+        Span* m_spanHead = nullptr;
+        uint64 m_spanSize = 0;
+        bool m_commitOnDemand = false;
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_PAGEARENA_H
@@ -0,0 +1,50 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_PERSISTENTHEAP_H
+#define COMPOSITE_MEMORY_ALLOCATOR_PERSISTENTHEAP_H
+
+#include "CompositeMemoryAllocator.h"
+
+namespace PersistentHeap {
+    static constexpr uint32 ROOT_COUNT = 16;
+
+    struct Header;
+
+    // CompositeMemoryAllocator whose pages and state live in a file mapping. The file is
+    // always mapped at the same base address, so pointers stored in it stay valid and a
+    // restarted process gets its heap back without rebuilding or deserializing anything.
+    // Objects are found again through the root slots.
+    class PersistentHeap {
+    public:
+        PersistentHeap() = default;
+        ~PersistentHeap();
+
+        PersistentHeap(const PersistentHeap&) = delete;
+        PersistentHeap& operator = (const PersistentHeap&) = delete;
+        PersistentHeap(PersistentHeap&&) = delete;
+        PersistentHeap& operator = (PersistentHeap&&) = delete;
+
+        // Creates the file or attaches to the heap stored in it. Fails when base is not
+        // free in this process or the file was written with another capacity, base or layout.
+        // A failed open leaves an existing file as it was and a new one empty.
+        bool open(const char* path, uint64 capacity, void* base);
+        // Unmaps without destroying the allocator, the heap stays in the file as is
+        void close();
+        // Writes dirty pages to the file
+        bool flush();
+
+        [[nodiscard]] bool isOpen() const { return m_header != nullptr; }
+        // false when open created a new heap
+        [[nodiscard]] bool attached() const { return m_attached; }
+        [[nodiscard]] CompositeMemoryAllocator::CompositeMemoryAllocator& allocator() const;
+        void setRoot(uint32 index, void* p);
+        [[nodiscard]] void* getRoot(uint32 index) const;
+
+    private:
+        Header* m_header = nullptr;
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+        bool m_attached = false;
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_PERSISTENTHEAP_H
@@ -0,0 +1,56 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_SHAREDHEAP_H
+#define COMPOSITE_MEMORY_ALLOCATOR_SHAREDHEAP_H
+
+#include "CompositeMemoryAllocator.h"
+
+namespace SharedHeap {
+    static constexpr uint32 ROOT_COUNT = 16;
+    // How long an attaching process waits for the creator to set the section up
+    static constexpr uint32 DEFAULT_ATTACH_TIMEOUT_MS = 5000;
+
+    struct Header;
+
+    // CompositeMemoryAllocator in a named shared memory section. Every process maps the
+    // section at the same base, so objects allocated by one process can be used in place
+    // by the others; they are handed over as offsets from the base. All processes share one
+    // allocator behind a spin lock in the section, a process that dies holding it blocks the rest.
+    class SharedHeap {
+    public:
+        SharedHeap() = default;
+        ~SharedHeap();
+
+        SharedHeap(const SharedHeap&) = delete;
+        SharedHeap& operator = (const SharedHeap&) = delete;
+        SharedHeap(SharedHeap&&) = delete;
+        SharedHeap& operator = (SharedHeap&&) = delete;
+
+        // The first process creates the section, the others attach to it and wait until it is
+        // set up. Fails when base is not free in this process or capacity differs from the creator's,
+        // and for an attacher when the creator failed or did not finish within attachTimeoutMs.
+        bool open(const char* name, uint64 capacity, void* base, uint32 attachTimeoutMs = DEFAULT_ATTACH_TIMEOUT_MS);
+        // The section is released with the last process that closes it
+        void close();
+
+        void* alloc(uint32 size);
+        // Any process may free a block, not only the one that allocated it
+        void free(void* p);
+
+        [[nodiscard]] bool isOpen() const { return m_header != nullptr; }
+        [[nodiscard]] bool created() const { return m_created; }
+        [[nodiscard]] uint64 toOffset(const void* p) const;
+        [[nodiscard]] void* fromOffset(uint64 offset) const;
+        void setRoot(uint32 index, void* p);
+        [[nodiscard]] void* getRoot(uint32 index) const;
+
+    private:
+        void lock();
+        void unlock();
+
+        Header* m_header = nullptr;
+        void* m_mapping = nullptr;
+        bool m_created = false;
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_SHAREDHEAP_H
@@ -0,0 +1,64 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_SNAPSHOTHEAP_H
+#define COMPOSITE_MEMORY_ALLOCATOR_SNAPSHOTHEAP_H
+
+#include "CompositeMemoryAllocator.h"
+
+namespace SnapshotHeap {
+    static constexpr uint32 ROOT_COUNT = 16;
+
+    struct Header;
+
+    // CompositeMemoryAllocator in an anonymous memory section that can take a point-in-time
+    // snapshot of itself. takeSnapshot maps the section a second time as the snapshot and
+    // remaps the live heap copy-on-write at the same base, so nothing is copied up front and
+    // only pages written afterwards get duplicated.
+    // Pointers stored in the snapshot still point at the live heap, inSnapshot translates them.
+    // Needs Windows 10 1803 or later for placeholder mappings.
+    class SnapshotHeap {
+    public:
+        SnapshotHeap() = default;
+        ~SnapshotHeap();
+
+        SnapshotHeap(const SnapshotHeap&) = delete;
+        SnapshotHeap& operator = (const SnapshotHeap&) = delete;
+        SnapshotHeap(SnapshotHeap&&) = delete;
+        SnapshotHeap& operator = (SnapshotHeap&&) = delete;
+
+        // Fails when base is not free in this process
+        bool open(uint64 capacity, void* base);
+        void close();
+
+        [[nodiscard]] bool isOpen() const { return m_header != nullptr; }
+        [[nodiscard]] CompositeMemoryAllocator::CompositeMemoryAllocator& allocator() const;
+        void setRoot(uint32 index, void* p);
+        [[nodiscard]] void* getRoot(uint32 index) const;
+
+        // One snapshot at a time. The heap must not be used by other threads while
+        // the snapshot is taken or released. Both fail only when the OS cannot map the live
+        // heap again; if not even the previous view comes back, the heap is closed
+        bool takeSnapshot();
+        // Writes the pages modified since the snapshot back to the section and maps it
+        // shared again. VirtualQuery finds the written pages, only they are copied. On failure
+        // the snapshot is kept, but it already shows the live heap; call again to release it
+        bool releaseSnapshot();
+        [[nodiscard]] bool hasSnapshot() const { return m_snapshot != nullptr; }
+        // Address of the object p in the snapshot, p is a live heap address
+        [[nodiscard]] const void* inSnapshot(const void* p) const;
+        template <typename T>
+        [[nodiscard]] const T* inSnapshot(const T* p) const { return static_cast<const T*>(inSnapshot((const void*)p)); }
+        [[nodiscard]] const void* getSnapshotRoot(uint32 index) const;
+
+    private:
+        [[nodiscard]] uint64 getHandedOutSize() const;
+        // Releases the section when the live view could not be mapped again
+        void discard();
+
+        Header* m_header = nullptr;
+        uint8* m_snapshot = nullptr;
+        void* m_mapping = nullptr;
+        uint64 m_capacity = 0;
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_SNAPSHOTHEAP_H
@@ -0,0 +1,117 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_SUBHEAP_H
+#define COMPOSITE_MEMORY_ALLOCATOR_SUBHEAP_H
+
+#include "CompositeMemoryAllocator.h"
+
+#include <mutex>
+
+namespace SubHeap {
+    static constexpr uint32 MAX_SUB_HEAPS = 32;
+    static constexpr uint32 MAX_NAME_LENGTH = 31;
+    // budget value of a sub-heap without a limit
+    static constexpr uint64 UNLIMITED = 0;
+
+    // Sizes are usable bytes: what usableSize reports for the live blocks.
+    // A successful realloc counts as one free and one alloc
+    struct StatReport {
+        uint64 liveSize = 0;
+        uint64 peakSize = 0;
+        uint64 allocCallCount = 0;
+        uint64 freeCallCount = 0;
+        // Allocations refused because they would have exceeded the budget
+        uint64 overBudgetCount = 0;
+        uint64 releaseAllCount = 0;
+    };
+
+    class SubHeapSet;
+
+    // One subsystem's own set of tiers, created by a SubHeapSet. Its memory is charged
+    // against a byte budget and can be released in one step with releaseAll. Has the
+    // interface of CompositeMemoryAllocator that MemoryAllocatorT uses, so it can be a Source.
+    // Thread-safe: all sub-heaps of a set share its lock
+    class SubHeap {
+    public:
+        SubHeap() = default;
+        ~SubHeap() = default;
+
+        SubHeap(const SubHeap&) = delete;
+        SubHeap& operator = (const SubHeap&) = delete;
+        SubHeap(SubHeap&&) = delete;
+        SubHeap& operator = (SubHeap&&) = delete;
+
+        // nullptr when the block would take the live size over the budget
+        void* alloc(uint32 size);
+        void* allocZeroed(uint32 size);
+        void* allocNear(uint32 size, const void* hint);
+        void* allocAligned(uint32 size, uint32 align);
+        void free(void* p);
+        // size is the one passed to alloc/realloc: selects the tier without a search
+        void free(void* p, uint32 size);
+        void freeAligned(void* p, uint32 size, uint32 align);
+        // Fails and keeps p when the grown block would exceed the budget
+        void* realloc(void* p, uint32 size);
+        [[nodiscard]] uint64 usableSize(void* p);
+        [[nodiscard]] uint64 goodSize(uint32 size);
+        [[nodiscard]] bool owns(void* p);
+        uint64 trim();
+        // Frees every block of the sub-heap in time proportional to its pages, e.g. to drop
+        // a cache without visiting its objects. Pointers into it must not be used or freed
+        // afterwards, containers holding them are discarded without running destructors
+        void releaseAll();
+        // A budget below the live size only refuses new allocations
+        void setBudget(uint64 budget);
+        [[nodiscard]] uint64 getBudget() const;
+        [[nodiscard]] StatReport getStat() const;
+        [[nodiscard]] const char* getName() const { return m_name; }
+
+    private:
+        friend class SubHeapSet;
+
+        // The caller holds the lock. Counts the refusal when size does not fit
+        bool admit(uint64 size);
+        void charge(uint64 size);
+        void credit(uint64 size);
+
+        CompositeMemoryAllocator::CompositeMemoryAllocator m_allocator;
+        SubHeapSet* m_set = nullptr;
+        uint64 m_budget = UNLIMITED;
+        StatReport m_stat = {};
+        char m_name[MAX_NAME_LENGTH + 1] = {};
+    };
+
+    // Named sub-heaps on top of one growable page heap: a page released by one sub-heap
+    // can be reused by any other, while each keeps its own tiers, budget and statistics
+    class SubHeapSet {
+    public:
+        SubHeapSet() = default;
+        ~SubHeapSet() = default;
+
+        SubHeapSet(const SubHeapSet&) = delete;
+        SubHeapSet& operator = (const SubHeapSet&) = delete;
+        SubHeapSet(SubHeapSet&&) = delete;
+        SubHeapSet& operator = (SubHeapSet&&) = delete;
+
+        void init();
+        // Releases every sub-heap with its blocks, then the page heap
+        void destroy();
+        // nullptr when the name is taken or too long, or all MAX_SUB_HEAPS are in use
+        SubHeap* create(const char* name, uint64 budget = UNLIMITED);
+        [[nodiscard]] SubHeap* find(const char* name);
+        [[nodiscard]] uint32 getCount() const { return m_count; }
+        [[nodiscard]] SubHeap& get(uint32 index) { return m_heaps[index]; }
+        // Reserved and handed out size of the shared page heap
+        [[nodiscard]] uint64 getCapacity();
+        [[nodiscard]] uint64 getUsedSize();
+
+    private:
+        friend class SubHeap;
+
+        PageArena::PageArena m_pageHeap;
+        std::mutex m_lock;
+        SubHeap m_heaps[MAX_SUB_HEAPS];
+        uint32 m_count = 0;
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_SUBHEAP_H
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "SubHeap.h"
+#include "MemoryAllocatorT.h"
+
+namespace MemoryAllocator {
+    // Binds the containers of one Tag to a sub-heap picked at run time:
+    //   SubHeapSource<CacheTag>::allocator = heaps.create("cache", 64 << 20);
+    // Over budget, allocate throws std::bad_alloc like any failed allocation
+    template <typename Tag>
+    struct SubHeapSource {
+        inline static SubHeap::SubHeap* allocator = nullptr;
+
+        static void init() {
+            if (allocator == nullptr)
+                throw std::bad_alloc{};
+        }
+    };
+
+    template <typename T, typename Tag>
+    using SubHeapAllocatorT = MemoryAllocatorT<T, SubHeapSource<Tag>>;
+}
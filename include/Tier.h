@@ -0,0 +1,115 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_TIER_H
+#define COMPOSITE_MEMORY_ALLOCATOR_TIER_H
+
+#include "FixedSizeAllocator.h"
+#include "CoalesceAllocator.h"
+
+namespace Tier {
+
+    struct StatReport {
+        uint64 allocCallCount = 0;
+        uint64 freeCallCount = 0;
+        // Usable size of the blocks currently handed out
+        uint64 liveSize = 0;
+    };
+
+    // Allocator for a size range, registered with CompositeMemoryAllocatorT::addTier.
+    // Blocks must be aligned to CompositeMemoryAllocator::DEFAULT_ALIGNMENT
+    class Tier {
+    public:
+        virtual ~Tier() = default;
+
+        virtual void* alloc(uint32 size) = 0;
+        virtual void free(void* p) = 0;
+        [[nodiscard]] virtual bool owns(const void* p) const = 0;
+        [[nodiscard]] virtual uint64 usableSize(const void* p) const = 0;
+        [[nodiscard]] virtual StatReport getStat() const = 0;
+        // Gives unused memory back to the OS, returns the size
+        virtual uint64 trim() = 0;
+    };
+
+    // Blocks of one size, e.g. a pool of 4KB I/O buffers
+    class FixedSizeTier final : public Tier {
+    public:
+        FixedSizeTier() = default;
+        ~FixedSizeTier() override = default;
+
+        FixedSizeTier(const FixedSizeTier&) = delete;
+        FixedSizeTier& operator = (const FixedSizeTier&) = delete;
+        FixedSizeTier(FixedSizeTier&&) = delete;
+        FixedSizeTier& operator = (FixedSizeTier&&) = delete;
+
+        void init(uint32 blockSize, PageArena::PageArena* arena = nullptr,
+                  FixedSizeAllocator::ReusePolicy policy = FixedSizeAllocator::ReusePolicy::Lifo);
+        void destroy();
+        void* alloc(uint32 size) override;
+        void free(void* p) override;
+        [[nodiscard]] bool owns(const void* p) const override;
+        [[nodiscard]] uint64 usableSize(const void* p) const override;
+        [[nodiscard]] StatReport getStat() const override { return m_stat; }
+        uint64 trim() override;
+
+    private:
+        FixedSizeAllocator::FixedSizeAllocator m_allocator;
+        StatReport m_stat;
+    };
+
+    // Variable sizes up to CoalesceAllocator::PAGE_SIZE
+    class CoalesceTier final : public Tier {
+    public:
+        CoalesceTier() = default;
+        ~CoalesceTier() override = default;
+
+        CoalesceTier(const CoalesceTier&) = delete;
+        CoalesceTier& operator = (const CoalesceTier&) = delete;
+        CoalesceTier(CoalesceTier&&) = delete;
+        CoalesceTier& operator = (CoalesceTier&&) = delete;
+
+        void init(PageArena::PageArena* arena = nullptr);
+        void destroy();
+        void* alloc(uint32 size) override;
+        void free(void* p) override;
+        [[nodiscard]] bool owns(const void* p) const override;
+        [[nodiscard]] uint64 usableSize(const void* p) const override;
+        [[nodiscard]] StatReport getStat() const override { return m_stat; }
+        uint64 trim() override;
+
+    private:
+        CoalesceAllocator::CoalesceAllocator m_allocator;
+        StatReport m_stat;
+    };
+
+    // Every block is its own VirtualAlloc reservation, released on free
+    class VirtualTier final : public Tier {
+    public:
+        VirtualTier() = default;
+        ~VirtualTier() override;
+
+        VirtualTier(const VirtualTier&) = delete;
+        VirtualTier& operator = (const VirtualTier&) = delete;
+        VirtualTier(VirtualTier&&) = delete;
+        VirtualTier& operator = (VirtualTier&&) = delete;
+
+        void* alloc(uint32 size) override;
+        void free(void* p) override;
+        [[nodiscard]] bool owns(const void* p) const override;
+        [[nodiscard]] uint64 usableSize(const void* p) const override;
+        [[nodiscard]] StatReport getStat() const override { return m_stat; }
+        uint64 trim() override { return 0; }
+
+    private:
+        struct alignas(16) Block {
+            Block* next;
+            Block* prev;
+            uint64 size;
+        };
+
+        Block* findBlock(const void* p) const;
+
+        Block* m_head = nullptr;
+        StatReport m_stat;
+    };
+}
+
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_TIER_H
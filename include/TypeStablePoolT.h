@@ -0,0 +1,82 @@
+#pragma once
+
+#include "FixedSizeAllocator.h"
+
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace MemoryAllocator {
+    // Pool of T over a type-stable FixedSizeAllocator: a block handed out once holds a T
+    // until destroy, freed blocks stay mapped and keep their first word, so optimistic
+    // lock-free readers may dereference a stale pointer and validate it afterwards
+    // (e.g. by a version counter in the first field) instead of using hazard pointers.
+    // alloc, free and contains are serialized by an internal lock, reading a block needs
+    // no synchronization.
+    template <typename T>
+    class TypeStablePoolT {
+        static_assert(std::is_trivially_destructible_v<T>, "TypeStablePoolT: T is never destroyed while the pool is alive");
+
+    public:
+        TypeStablePoolT() = default;
+
+        ~TypeStablePoolT()
+        {
+            if (m_initialized)
+                destroy();
+        }
+
+        TypeStablePoolT(const TypeStablePoolT&) = delete;
+        TypeStablePoolT& operator = (const TypeStablePoolT&) = delete;
+        TypeStablePoolT(TypeStablePoolT&&) = delete;
+        TypeStablePoolT& operator = (TypeStablePoolT&&) = delete;
+
+        void init(PageArena::PageArena* arena = nullptr) {
+            m_allocator.init(BLOCK_SIZE, arena, true);
+            m_initialized = true;
+        }
+
+        void destroy() {
+            m_allocator.destroy();
+            m_initialized = false;
+        }
+
+        // A fresh block is zero-filled, a reused one keeps the fields of the previous T
+        // (a version counter survives reuse), the caller updates them in place
+        T* alloc() {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            void* p = m_allocator.alloc(BLOCK_SIZE);
+            if (p == nullptr)
+                throw std::bad_alloc{};
+
+            return static_cast<T*>(p);
+        }
+
+        void free(T* p) {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_allocator.free(p);
+        }
+
+        // Walks the page list that alloc appends to, so it takes the lock too
+        bool contains(const T* p) const {
+            std::lock_guard<std::mutex> lock(m_lock);
+            return m_allocator.containsAddress((void*)p);
+        }
+
+    private:
+        // Power of two for natural alignment, with room for the free-list link past the T
+        static constexpr uint32 getBlockSize() {
+            uint32 size = 8;
+            while (size < sizeof(T) + sizeof(int) || size < alignof(T))
+                size <<= 1;
+            return size;
+        }
+
+        static constexpr uint32 BLOCK_SIZE = getBlockSize();
+
+        FixedSizeAllocator::FixedSizeAllocator m_allocator;
+        mutable std::mutex m_lock;
+        bool m_initialized = false;
+    };
+}
@@ -0,0 +1,18 @@
+#ifndef COMPOSITE_MEMORY_ALLOCATOR_VIRTUALMEMORY_H
+#define COMPOSITE_MEMORY_ALLOCATOR_VIRTUALMEMORY_H
+
+#include "Types.h"
+
+// Page-level OS calls for the template headers, so that including them does not pull
+// <windows.h> into client code
+namespace VirtualMemory {
+    // Reserved only, nullptr on failure
+    void* reserve(uint64 size);
+    // Read-write, a committed page reads as zero until it is written
+    bool commit(void* p, uint64 size);
+    void decommit(void* p, uint64 size);
+    // p is the base returned by reserve
+    void release(void* p);
+}
+
+#endif //COMPOSITE_MEMORY_ALLOCATOR_VIRTUALMEMORY_H
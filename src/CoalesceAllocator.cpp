@@ -27,10 +27,14 @@
 #include <algorithm>
 
 #include "BitOps.h"
+#include "MemOps.h"
 
 namespace CoalesceAllocator {
 	CoalesceAllocator::CoalesceAllocator() :
-		m_headPage(nullptr)
+		m_headPage(nullptr),
+		m_arena(nullptr),
+		m_compactPage(nullptr),
+		m_compactOffset(0)
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
 		, m_StatReport{}
 #endif
@@ -41,10 +45,12 @@ namespace CoalesceAllocator {
 			destroy();
 	}
 
-	void CoalesceAllocator::init() {
+	void CoalesceAllocator::init(PageArena::PageArena* arena) {
 		if (m_headPage != nullptr)
 			return;
 
+		m_arena = arena;
+
 		uint32 binIdx;
 		m_headPage = createPage(binIdx);
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
@@ -55,71 +61,92 @@ namespace CoalesceAllocator {
 	void CoalesceAllocator::destroy() {
 		ASSERT(m_headPage != nullptr);
 
-		while (m_headPage) {
-			Page* next = m_headPage->next;
-
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
-			uint32 fxIdx = binIndex(sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd));
-			ASSERT(m_headPage->fh[fxIdx]->size == sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd));
-			ASSERT(m_headPage->fh[fxIdx]->next == nullptr);
+		uint32 fxIdx = binIndex(sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd));
+		for (Page* page = m_headPage; page != nullptr; page = page->next) {
+			ASSERT(page->fh[fxIdx]->size == sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd));
+			ASSERT(page->fh[fxIdx]->next == nullptr);
+		}
 #endif
 
-			if (!VirtualFree(m_headPage, 0, MEM_RELEASE)) {
+		releasePages();
+	}
+
+	void CoalesceAllocator::releaseAll() {
+		ASSERT(m_headPage != nullptr);
+
+		releasePages();
+
+		uint32 binIdx;
+		m_headPage = createPage(binIdx);
+		ASSERT(m_headPage != nullptr);
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
-				printf("VirtualFree failed.\n");
+		m_StatReport.pagesCount = 1;
 #endif
-				return;
-			}
+	}
 
+	// A page the OS does not take back is leaked, the others are still released
+	void CoalesceAllocator::releasePages() {
+		while (m_headPage) {
+			Page* next = m_headPage->next;
+			releasePage(m_headPage);
 			m_headPage = next;
 		}
+
+		m_compactPage = nullptr;
+		m_compactOffset = 0;
 	}
 
 	void* CoalesceAllocator::alloc(uint32 size) {
+		bool zeroed;
+		return allocBlock(size, ALIGNMENT, zeroed);
+	}
+
+	void* CoalesceAllocator::allocAligned(uint32 size, uint32 align) {
+		bool zeroed;
+		return allocBlock(size, align, zeroed);
+	}
+
+	void* CoalesceAllocator::allocZeroed(uint32 size) {
+		bool zeroed;
+		void* p = allocBlock(size, ALIGNMENT, zeroed);
+		if (p == nullptr)
+			return nullptr;
+
+		if (zeroed) {
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+			*(uint32*)p = 0; // DEADBEEF of the free block
+#endif
+		}
+		else {
+			MemOps::zero(p, getAllocSize(p));
+		}
+
+		return p;
+	}
+
+	void* CoalesceAllocator::allocBlock(uint32 size, uint32 align, bool& outZeroed) {
 		ASSERT(m_headPage != nullptr);
+		ASSERT(align != 0 && (align & (align - 1)) == 0);
 
 		if (size > PAGE_SIZE)
 			return nullptr;
 
-		Page* page = m_headPage;
+		align = std::max(align, ALIGNMENT);
+		uint32 blockSize = getBlockSizeFor(size);
 
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
 		m_StatReport.allocCallCount++;
 		m_StatReport.totalAllocSize += size;
 #endif
 
+		Page* page = m_headPage;
 		while (true) {
-			//<--------(fb->size)-------->
-			// ↓(fb)
-			//[BlockStart][size][BlockEnd]
-			uint32 binIdx;
-			BlockStart* fb = findFreeBlock(page, sizeof(BlockStart) + size + sizeof(BlockEnd), binIdx);
-
-			if (fb != nullptr) {
-				ASSERT(fb->size >= sizeof(BlockStart) + size + sizeof(BlockEnd));
-				VALIDATE_BLOCK(fb, true);
-
-				if (fb->next) fb->next->prev = fb->prev;
-				if (fb->prev) fb->prev->next= fb->next;
-				else page->fh[binIdx] = fb->next;
-
-				// <----------------------(fb->size)-------------------------->
-				//   ↓(fb)                         ↓(nfb)
-				// <[BlockStart][size][BlockEnd]> <[BlockStart][...][BlockEnd]>
-				if (fb->size >= size + 2 * sizeof(BlockStart) + 2 * sizeof(BlockEnd)) {
-					auto* nfb = (BlockStart*)((BYTE*)fb + sizeof(BlockStart) + size + sizeof(BlockEnd));
-					uint32 nfbSize = fb->size - size - sizeof(BlockStart) - sizeof(BlockEnd);
-					fb->size -= nfbSize;
-
-					uint32 nfdBinIdx = binIndex(nfbSize);
-					ASSERT(page->fh[nfdBinIdx] == nullptr || page->fh[nfdBinIdx]->prev == nullptr);
-					setupBlock(nfb, nfbSize, page->fh[nfdBinIdx], nullptr, true);
-					page->fh[nfdBinIdx] = nfb;
-				}
+			uint8* payload;
+			BlockStart* fb = findFreeBlock(page, blockSize, align, payload);
 
-				setupBlock(fb, fb->size, nullptr, nullptr, false);
-				return (BYTE*)fb + sizeof(BlockStart);
-			}
+			if (fb != nullptr)
+				return placeBlock(page, fb, (BlockStart*)(payload - sizeof(BlockStart)), blockSize, outZeroed);
 
 			if (page->next == nullptr)
 				break;
@@ -128,28 +155,50 @@ namespace CoalesceAllocator {
 		}
 
 		uint32 binIdx;
-		page->next = createPage(binIdx);
-		page = page->next;
+		Page* newPage = createPage(binIdx);
+		if (newPage == nullptr)
+			return nullptr;
 
+		// Only an alignment close to the page size can fail here, the page is not kept:
+		// repeating the request would add another one every time
+		uint8* payload;
+		BlockStart* fb = findFreeBlock(newPage, blockSize, align, payload);
+		if (fb == nullptr) {
+			releasePage(newPage);
+			return nullptr;
+		}
+
+		page->next = newPage;
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
 		m_StatReport.pagesCount++;
 #endif
 
-		uint32 pageSize = page->fh[binIdx]->size;
-		if (pageSize >= size + 2 * sizeof(BlockStart) + 2 * sizeof(BlockEnd)) {
-			uint32 nfbSize = pageSize - sizeof(BlockStart) - size - sizeof(BlockEnd);
-			pageSize -= nfbSize;
-			auto* nfb = (BlockStart*)((BYTE*)page + sizeof(Page) + pageSize);
-			setupBlock(nfb, nfbSize, nullptr, nullptr, true);
-			page->fh[binIdx] = nullptr;
-			page->fh[binIndex(nfb->size)] = nfb;
-		}
-		else {
-			page->fh[binIdx] = nullptr;
+		return placeBlock(newPage, fb, (BlockStart*)(payload - sizeof(BlockStart)), blockSize, outZeroed);
+	}
+
+	// <----------------------------------(fb->size)------------------------------------->
+	//   ↓(fb)                           ↓(ab)                     ↓(tail)
+	// <[BlockStart][prefix][BlockEnd]> <[BlockStart][size][BlockEnd]> <[BlockStart][...][BlockEnd]>
+	//
+	// Payloads of the prefix, ab and tail all lie inside the payload of fb, so they inherit its zeroed flag
+	void* CoalesceAllocator::placeBlock(Page* page, BlockStart* fb, BlockStart* ab, uint32 size, bool& outZeroed) {
+		VALIDATE_BLOCK(fb, true);
+		unlinkBlock(page, fb);
+
+		outZeroed = fb->zeroed != 0;
+
+		BYTE* end = (BYTE*)fb + fb->size;
+		if (ab != fb)
+			pushFreeBlock(page, fb, (uint32)((BYTE*)ab - (BYTE*)fb), outZeroed);
+
+		auto abSize = (uint32)(end - (BYTE*)ab);
+		if (abSize >= size + MIN_BLOCK_SIZE) {
+			pushFreeBlock(page, (BlockStart*)((BYTE*)ab + size), abSize - size, outZeroed);
+			abSize = size;
 		}
 
-		setupBlock(((BlockStart*)((BYTE*)page + sizeof(Page))), pageSize, nullptr, nullptr, false);
-		return (BYTE*)page + sizeof(Page) + sizeof(BlockStart);
+		setupBlock(ab, abSize, nullptr, nullptr, false);
+		return (BYTE*)ab + sizeof(BlockStart);
 	}
 
 	//             ↓(p)
@@ -157,26 +206,106 @@ namespace CoalesceAllocator {
 	void CoalesceAllocator::free(void* p) {
 		ASSERT(m_headPage != nullptr);
 
+		Page* page = findPage(p);
+		if (page == nullptr)
+		{
+			ASSERT(false);
+			return;
+		}
+
+		VALIDATE_BLOCK((BlockStart*)((BYTE*)p - sizeof(BlockStart)), false);
+
+		releaseBlock(page, (BlockStart*)((BYTE*)p - sizeof(BlockStart)));
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+		m_StatReport.freeCallCount++;
+#endif
+	}
+
+	// Grow:
+	//   ↓(cb)                  ↓(rb, free)
+	// [BlockStart][..(p)..][BlockEnd][BlockStart][......][BlockEnd]
+	// [BlockStart][.......(p)........][BlockEnd][BlockStart][.][BlockEnd]
+	//
+	// Shrink:
+	// [BlockStart][.......(p).......][BlockEnd]
+	// [BlockStart][..(p)..][BlockEnd][BlockStart][.][BlockEnd] <- tail is released
+	bool CoalesceAllocator::resize(void* p, uint32 size) {
+		ASSERT(m_headPage != nullptr);
+
+		if (size > PAGE_SIZE)
+			return false;
+
+		Page* page = findPage(p);
+		if (page == nullptr)
+		{
+			ASSERT(false);
+			return false;
+		}
+
+		auto* cb = (BlockStart*)((BYTE*)p - sizeof(BlockStart));
+		VALIDATE_BLOCK(cb, false);
+
+		uint32 newSize = getBlockSizeFor(size);
+
+		if (newSize > cb->size) {
+			auto* rb = (BlockStart*)((BYTE*)cb + cb->size);
+
+			if (!insidePage(page, (BYTE*)rb + sizeof(BlockStart)) || rb->alloc || cb->size + rb->size < newSize)
+				return false;
+
+			VALIDATE_BLOCK(rb, true);
+			unlinkBlock(page, rb);
+			cb->size += rb->size;
+		}
+
+		if (cb->size < newSize + MIN_BLOCK_SIZE) {
+			setupBlock(cb, cb->size, nullptr, nullptr, false);
+			return true;
+		}
+
+		uint32 tailSize = cb->size - newSize;
+		setupBlock(cb, newSize, nullptr, nullptr, false);
+
+		auto* tail = (BlockStart*)((BYTE*)cb + newSize);
+		setupBlock(tail, tailSize, nullptr, nullptr, false);
+		releaseBlock(page, tail);
+
+		return true;
+	}
+
+	uint32 CoalesceAllocator::getAllocSize(void* p) {
+		auto* cb = (BlockStart*)((BYTE*)p - sizeof(BlockStart));
+		VALIDATE_BLOCK(cb, false);
+		return cb->size - (uint32)sizeof(BlockStart) - (uint32)sizeof(BlockEnd);
+	}
+
+	CoalesceAllocator::Page* CoalesceAllocator::findPage(void* p) const {
 		Page* page = m_headPage;
 		while (page != nullptr) {
 			// ↓(page)
 			//[Page][BlockStart][..(p)..][BlockEnd]
-			if (insidePage(page, p)) {
-				VALIDATE_BLOCK((BlockStart*)((BYTE*)p - sizeof(BlockStart)), false);
-				break;
-			}
+			if (insidePage(page, p))
+				return page;
 			page = page->next;
 		}
 
-		if (page == nullptr)
+		return nullptr;
+	}
+
+	void CoalesceAllocator::unlinkBlock(Page* page, BlockStart* block) {
+		if (block->next) block->next->prev = block->prev;
+		if (block->prev) block->prev->next = block->next;
+		else
 		{
-			ASSERT(false);
-			return;
+			ASSERT(page->fh[binIndex(block->size)] == block);
+			page->fh[binIndex(block->size)] = block->next;
 		}
+	}
 
+	// Merges the block with its free neighbours and pushes the result to the bin
+	void CoalesceAllocator::releaseBlock(Page* page, BlockStart* cb) {
 		auto* pageStart = (BYTE*)page + sizeof(Page);
 
-		auto* cb = (BlockStart*)((BYTE*)p - sizeof(BlockStart));
 		size_t lbs = (BYTE*)cb == pageStart ? 0 : ((BlockEnd*)((BYTE*)cb - sizeof(BlockEnd)))->size;
 		auto* lb = (BlockStart*)((BYTE*)cb - lbs);
 		auto* rb = (BlockStart*)((BYTE*)cb + cb->size);
@@ -189,13 +318,7 @@ namespace CoalesceAllocator {
 		if (lb != nullptr) {
 			VALIDATE_BLOCK(lb, true);
 
-			if (lb->next) lb->next->prev = lb->prev;
-			if (lb->prev) lb->prev->next = lb->next;
-			else
-			{
-				ASSERT(page->fh[binIndex(lb->size)] == lb);
-				page->fh[binIndex(lb->size)] = lb->next;
-			}
+			unlinkBlock(page, lb);
 
 			lb->size += cb->size;
 			cb = lb;
@@ -204,38 +327,19 @@ namespace CoalesceAllocator {
 		if (rb != nullptr) {
 			VALIDATE_BLOCK(rb, true);
 
-			cb->size += rb->size;
-
-			if (rb->next) rb->next->prev = rb->prev;
-			if (rb->prev) rb->prev->next = rb->next;
-			else
-			{
-				ASSERT(page->fh[binIndex(rb->size)] == rb);
-				page->fh[binIndex(rb->size)] = rb->next;
-			}
-		}
-
-		uint32 cbBinIdx = binIndex(cb->size);
+			unlinkBlock(page, rb);
 
-		if (page->fh[cbBinIdx])
-		{
-			ASSERT(page->fh[cbBinIdx]->prev == nullptr);
-			page->fh[cbBinIdx]->prev = cb;
+			cb->size += rb->size;
 		}
 
-		cb->next = page->fh[cbBinIdx];
-		cb->prev = nullptr;
-		page->fh[cbBinIdx] = cb;
-
-		setupBlock(cb, cb->size, cb->next, cb->prev, true);
-#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
-		m_StatReport.freeCallCount++;
-#endif
+		pushFreeBlock(page, cb, cb->size, false);
 	}
 
 	CoalesceAllocator::Page* CoalesceAllocator::createPage(uint32& outBinIdx) {
-		Page* page = (Page*)VirtualAlloc(nullptr, sizeof(Page) + sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd),
-			MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		uint32 pageSize = sizeof(Page) + sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd);
+		Page* page = m_arena != nullptr
+			? (Page*)m_arena->allocPages(pageSize)
+			: (Page*)VirtualAlloc(nullptr, pageSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
 
 		if (page == nullptr) {
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
@@ -250,29 +354,76 @@ namespace CoalesceAllocator {
 		outBinIdx = binIndex(sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd));
 		page->fh[outBinIdx] = (BlockStart*)((BYTE*)page + sizeof(Page));
 		setupBlock(page->fh[outBinIdx], sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd), nullptr, nullptr, true);
+		page->fh[outBinIdx]->zeroed = 1;
 
 		return page;
 	}
 
+	bool CoalesceAllocator::releasePage(Page* page) const {
+		if (m_arena != nullptr) {
+			m_arena->freePages(page, sizeof(Page) + sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd));
+		}
+		else if (!VirtualFree(page, 0, MEM_RELEASE)) {
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+			printf("VirtualFree failed.\n");
+#endif
+			return false;
+		}
+
+		return true;
+	}
+
 	uint32 CoalesceAllocator::binIndex(uint32 size)
 	{
 		ASSERT(size > 0);
 		return std::min(BitOps::log2_floor(size), NUM_BINS - 1);
 	}
 
-	CoalesceAllocator::BlockStart* CoalesceAllocator::findFreeBlock(const CoalesceAllocator::Page* page, uint32 size, uint32& outBinIdx) {
-		for (outBinIdx = binIndex(size); outBinIdx < NUM_BINS; ++outBinIdx) {
-			if (BlockStart* output = page->fh[outBinIdx]) {
-				while (output && output->size < size) output = output->next;
-				if (output)
+	CoalesceAllocator::BlockStart* CoalesceAllocator::findFreeBlock(const CoalesceAllocator::Page* page, uint32 size, uint32 align, uint8*& outPayload) {
+		for (uint32 binIdx = binIndex(size); binIdx < NUM_BINS; ++binIdx) {
+			for (BlockStart* output = page->fh[binIdx]; output; output = output->next) {
+				if (output->size < size)
+					continue;
+
+				uint8* payload = alignedPayload(output, align);
+				if (payload - sizeof(BlockStart) + size <= (BYTE*)output + output->size) {
+					outPayload = payload;
 					return output;
+				}
 			}
 		}
 
-		outBinIdx = -1;
 		return nullptr;
 	}
 
+	// First aligned payload inside the free block whose prefix is either empty or big enough to stay a free block
+	uint8* CoalesceAllocator::alignedPayload(BlockStart* block, uint32 align) {
+		auto first = (uintptr_t)block + sizeof(BlockStart);
+		auto payload = (first + align - 1) & ~(uintptr_t)(align - 1);
+
+		if (payload != first && payload - first < MIN_BLOCK_SIZE)
+			payload += (MIN_BLOCK_SIZE - (payload - first) + align - 1) & ~(uintptr_t)(align - 1);
+
+		return (uint8*)payload;
+	}
+
+	uint32 CoalesceAllocator::getBlockSizeFor(uint32 size) {
+		uint32 blockSize = (sizeof(BlockStart) + size + sizeof(BlockEnd) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		return std::min<uint32>(blockSize, sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd));
+	}
+
+	uint32 CoalesceAllocator::goodSize(uint32 size) {
+		return getBlockSizeFor(size) - (uint32)sizeof(BlockStart) - (uint32)sizeof(BlockEnd);
+	}
+
+	void CoalesceAllocator::pushFreeBlock(Page* page, BlockStart* block, uint32 size, bool zeroed) {
+		uint32 binIdx = binIndex(size);
+		ASSERT(page->fh[binIdx] == nullptr || page->fh[binIdx]->prev == nullptr);
+		setupBlock(block, size, page->fh[binIdx], nullptr, true);
+		block->zeroed = zeroed ? 1 : 0;
+		page->fh[binIdx] = block;
+	}
+
 	void CoalesceAllocator::setupBlock(BlockStart* block, uint32 size, BlockStart* next, BlockStart* prev, bool free) {
 		block->alloc = free ? 0 : 1;
 		block->size = size;
@@ -307,6 +458,150 @@ namespace CoalesceAllocator {
 		return false;
 	}
 
+	CompactResult CoalesceAllocator::compact(uint32 maxMoves, CanMoveFunc canMove, MovedFunc moved, void* context) {
+		ASSERT(m_headPage != nullptr);
+
+		CompactResult result;
+		Page* page = m_compactPage ? m_compactPage : m_headPage;
+		BlockStart* prev;
+		BlockStart* block = findBlockAt(page, m_compactOffset, prev);
+		auto* pageEnd = (BYTE*)page + sizeof(Page) + sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd);
+
+		while (true) {
+			if ((BYTE*)block == pageEnd) {
+				// Whatever was slid down left one free block at the end of the page
+				if (prev && !prev->alloc)
+					result.releasedSize += resetFreeBlock(prev);
+
+				page = page->next;
+				if (page == nullptr) {
+					result.passDone = true;
+					break;
+				}
+
+				block = (BlockStart*)((BYTE*)page + sizeof(Page));
+				pageEnd = (BYTE*)page + sizeof(Page) + sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd);
+				prev = nullptr;
+				continue;
+			}
+
+			if (result.movedCount == maxMoves)
+				break;
+
+			void* payload = (BYTE*)block + sizeof(BlockStart);
+			if (block->alloc && prev && !prev->alloc && canMove(payload, context)) {
+				BlockStart* rest = slideBlock(page, prev, block);
+				moved(payload, (BYTE*)prev + sizeof(BlockStart), context);
+				result.movedCount++;
+				block = rest;
+			}
+
+			prev = block;
+			block = (BlockStart*)((BYTE*)block + block->size);
+		}
+
+		m_compactPage = page;
+		m_compactOffset = page ? (uint32)((BYTE*)block - (BYTE*)page) : 0;
+		return result;
+	}
+
+	uint64 CoalesceAllocator::trim() {
+		ASSERT(m_headPage != nullptr);
+
+		constexpr uint32 fullBlockSize = sizeof(BlockStart) + PAGE_SIZE + sizeof(BlockEnd);
+		uint64 released = 0;
+
+		Page* prev = nullptr;
+		Page* page = m_headPage;
+		while (page) {
+			Page* next = page->next;
+			auto* first = (BlockStart*)((BYTE*)page + sizeof(Page));
+
+			if (prev && !first->alloc && first->size == fullBlockSize) {
+				prev->next = next;
+				if (m_compactPage == page) {
+					m_compactPage = nullptr;
+					m_compactOffset = 0;
+				}
+
+				if (releasePage(page)) {
+					released += sizeof(Page) + fullBlockSize;
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+					m_StatReport.pagesCount--;
+#endif
+				}
+			}
+			else {
+				for (BlockStart* bin : page->fh) {
+					for (BlockStart* block = bin; block; block = block->next)
+						released += resetFreeBlock(block);
+				}
+				prev = page;
+			}
+
+			page = next;
+		}
+
+		return released;
+	}
+
+	//   ↓(fb)                       ↓(ab)                              ↓(rb, may be free)
+	// [BlockStart][free][BlockEnd][BlockStart][..payload..][BlockEnd][......]
+	// [BlockStart][..payload..][BlockEnd][BlockStart][free.............][...]
+	//
+	// Returns the free block left behind the moved one
+	CoalesceAllocator::BlockStart* CoalesceAllocator::slideBlock(Page* page, BlockStart* fb, BlockStart* ab) {
+		VALIDATE_BLOCK(fb, true);
+		VALIDATE_BLOCK(ab, false);
+
+		uint32 freeSize = fb->size;
+		uint32 size = ab->size;
+		unlinkBlock(page, fb);
+
+		auto* rb = (BlockStart*)((BYTE*)ab + size);
+		if (insidePage(page, (BYTE*)rb + sizeof(BlockStart)) && !rb->alloc) {
+			VALIDATE_BLOCK(rb, true);
+			unlinkBlock(page, rb);
+			freeSize += rb->size;
+		}
+
+		// The payloads may overlap, the new header only overwrites the old free block
+		memmove((BYTE*)fb + sizeof(BlockStart), (BYTE*)ab + sizeof(BlockStart), size - sizeof(BlockStart) - sizeof(BlockEnd));
+		setupBlock(fb, size, nullptr, nullptr, false);
+
+		auto* rest = (BlockStart*)((BYTE*)fb + size);
+		pushFreeBlock(page, rest, freeSize, false);
+		return rest;
+	}
+
+	// First block at or after offset from the page
+	CoalesceAllocator::BlockStart* CoalesceAllocator::findBlockAt(Page* page, uint32 offset, BlockStart*& outPrev) {
+		auto* block = (BlockStart*)((BYTE*)page + sizeof(Page));
+		outPrev = nullptr;
+		while ((uint32)((BYTE*)block - (BYTE*)page) < offset && insidePage(page, (BYTE*)block + sizeof(BlockStart))) {
+			outPrev = block;
+			block = (BlockStart*)((BYTE*)block + block->size);
+		}
+
+		return block;
+	}
+
+	// Drops the physical pages inside a free block, the block stays committed
+	uint64 CoalesceAllocator::resetFreeBlock(BlockStart* block) const {
+		// Mapped arenas can't be reset, a zeroed block has not been touched yet
+		if ((m_arena != nullptr && !m_arena->isCommitOnDemand()) || block->zeroed)
+			return 0;
+
+		// Keep the header and the debug DEADBEEF after it
+		auto start = ((uintptr_t)block + sizeof(BlockStart) + ALIGNMENT + PageArena::PAGE_SIZE - 1) & ~(uintptr_t)(PageArena::PAGE_SIZE - 1);
+		auto end = ((uintptr_t)block + block->size - sizeof(BlockEnd)) & ~(uintptr_t)(PageArena::PAGE_SIZE - 1);
+		if (end <= start)
+			return 0;
+
+		VirtualAlloc((void*)start, end - start, MEM_RESET, PAGE_READWRITE);
+		return end - start;
+	}
+
 	bool CoalesceAllocator::insidePage(Page* page, void* p) {
 		return ((BYTE*)p >= (BYTE*)page + sizeof(Page) + sizeof(BlockStart) &&
 			(BYTE*)p <= (BYTE*)page + sizeof(Page) + PAGE_SIZE + sizeof(BlockStart));
@@ -0,0 +1,39 @@
+#include "CompressedHeap.h"
+#include "Common.h"
+
+namespace CompressedHeap {
+    CompressedHeap::~CompressedHeap() {
+        if (m_arena.getBase() != nullptr)
+            destroy();
+    }
+
+    bool CompressedHeap::init(uint64 capacity) {
+        ASSERT(s_base == nullptr);
+        ASSERT(capacity > PageArena::PAGE_SIZE && capacity <= MAX_CAPACITY);
+
+        auto* base = (uint8*)VirtualAlloc(nullptr, capacity, MEM_RESERVE, PAGE_NOACCESS);
+        if (base == nullptr)
+            return false;
+
+        // The first page keeps offset 0 free for nullptr
+        m_arena.init(base + PageArena::PAGE_SIZE, capacity - PageArena::PAGE_SIZE, true);
+        m_allocator.init(&m_arena);
+        s_base = base;
+        return true;
+    }
+
+    void CompressedHeap::destroy() {
+        ASSERT(s_base != nullptr);
+
+        m_allocator.destroy();
+
+        if (!VirtualFree(s_base, 0, MEM_RELEASE)) {
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+            printf("VirtualFree failed.\n");
+#endif
+        }
+
+        m_arena.init(nullptr, 0, true);
+        s_base = nullptr;
+    }
+}
@@ -0,0 +1,173 @@
+#include "EpochDomain.h"
+#include "Common.h"
+
+namespace EpochDomain {
+    static std::unique_lock<std::mutex> lockAllocator(std::mutex* allocatorLock) {
+        return allocatorLock ? std::unique_lock<std::mutex>(*allocatorLock) : std::unique_lock<std::mutex>();
+    }
+
+    void EpochDomain::init(CompositeMemoryAllocator::CompositeMemoryAllocator* allocator, std::mutex* allocatorLock) {
+        ASSERT(allocator != nullptr);
+
+        m_allocator = allocator;
+        m_allocatorLock = allocatorLock;
+        m_epoch.store(1);
+    }
+
+    void EpochDomain::destroy() {
+        for (auto& record : m_records) {
+            ASSERT(!record.used.load());
+
+            for (auto& bucket : record.buckets)
+                freeBucket(bucket);
+        }
+    }
+
+    EpochDomain::ThreadRecord* EpochDomain::registerThread() {
+        for (auto& record : m_records) {
+            bool expected = false;
+            if (record.used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return &record;
+        }
+
+        return nullptr;
+    }
+
+    // Blocks that are not safe yet stay with the record, its next owner or destroy frees them
+    void EpochDomain::unregisterThread(ThreadRecord* record) {
+        ASSERT(record->state.load(std::memory_order_relaxed) == 0);
+
+        reclaim(record);
+        record->used.store(false, std::memory_order_release);
+    }
+
+    void EpochDomain::enter(ThreadRecord* record) {
+        ASSERT(record->state.load(std::memory_order_relaxed) == 0);
+
+        // Publish an epoch that is still current after the store, so an advance
+        // between the load and the store can't leave this thread behind unnoticed
+        uint64 epoch = m_epoch.load();
+        while (true) {
+            record->state.store(epoch << 1 | 1);
+
+            uint64 current = m_epoch.load();
+            if (current == epoch)
+                break;
+
+            epoch = current;
+        }
+    }
+
+    void EpochDomain::exit(ThreadRecord* record) {
+        record->state.store(0, std::memory_order_release);
+    }
+
+    void EpochDomain::retire(ThreadRecord* record, void* p, uint32 size) {
+        m_retiredCount.fetch_add(1, std::memory_order_relaxed);
+
+        uint64 epoch = m_epoch.load();
+        Bucket& bucket = record->buckets[epoch % 3];
+
+        // The bucket last held epoch - 3 or older, which is safe by now
+        if (bucket.epoch != epoch) {
+            freeBucket(bucket);
+            bucket.epoch = epoch;
+        }
+
+        if (!push(bucket, p, size)) {
+            // Out of memory for the list: the block is leaked rather than freed too early
+            ASSERT(false);
+        }
+
+        if (++record->sinceScan >= BATCH_SIZE) {
+            record->sinceScan = 0;
+            tryAdvance();
+            reclaim(record);
+        }
+    }
+
+    void EpochDomain::flush(ThreadRecord* record) {
+        for (uint32 i = 0; i < 3; i++) {
+            tryAdvance();
+            reclaim(record);
+        }
+    }
+
+    StatReport EpochDomain::getStat() const {
+        return StatReport{ m_retiredCount.load(std::memory_order_relaxed), m_reclaimedCount.load(std::memory_order_relaxed) };
+    }
+
+    // The epoch moves on only when every thread inside a critical section has seen the current one
+    bool EpochDomain::tryAdvance() {
+        uint64 epoch = m_epoch.load();
+
+        for (auto& record : m_records) {
+            if (!record.used.load(std::memory_order_acquire))
+                continue;
+
+            uint64 state = record.state.load();
+            if ((state & 1) && (state >> 1) != epoch)
+                return false;
+        }
+
+        return m_epoch.compare_exchange_strong(epoch, epoch + 1);
+    }
+
+    void EpochDomain::reclaim(ThreadRecord* record) {
+        uint64 epoch = m_epoch.load();
+
+        for (auto& bucket : record->buckets) {
+            if (bucket.head != nullptr && bucket.epoch + 2 <= epoch)
+                freeBucket(bucket);
+        }
+    }
+
+    void EpochDomain::freeBucket(Bucket& bucket) {
+        if (bucket.head == nullptr)
+            return;
+
+        uint64 count = 0;
+        {
+            auto lock = lockAllocator(m_allocatorLock);
+
+            Chunk* chunk = bucket.head;
+            while (chunk) {
+                Chunk* next = chunk->next;
+
+                for (uint32 i = 0; i < chunk->count; i++) {
+                    if (chunk->entries[i].size)
+                        m_allocator->free(chunk->entries[i].p, chunk->entries[i].size);
+                    else
+                        m_allocator->free(chunk->entries[i].p);
+                }
+
+                count += chunk->count;
+                m_allocator->free(chunk, sizeof(Chunk));
+                chunk = next;
+            }
+        }
+
+        bucket.head = nullptr;
+        m_reclaimedCount.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    bool EpochDomain::push(Bucket& bucket, void* p, uint32 size) {
+        if (bucket.head == nullptr || bucket.head->count == CHUNK_CAPACITY) {
+            Chunk* chunk;
+            {
+                auto lock = lockAllocator(m_allocatorLock);
+                chunk = (Chunk*)m_allocator->alloc(sizeof(Chunk));
+            }
+
+            if (chunk == nullptr)
+                return false;
+
+            chunk->next = bucket.head;
+            chunk->count = 0;
+            bucket.head = chunk;
+        }
+
+        bucket.head->entries[bucket.head->count++] = Retired{ p, size };
+        return true;
+    }
+}
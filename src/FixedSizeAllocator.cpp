@@ -1,10 +1,18 @@
 #include "FixedSizeAllocator.h"
 #include "Common.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 namespace FixedSizeAllocator {
     FixedSizeAllocator::FixedSizeAllocator() :
         m_blockSize(-1),
-        m_headPage(nullptr)
+        m_dataOffset(0),
+        m_linkOffset(0),
+        m_reusePolicy(ReusePolicy::Lifo),
+        m_headPage(nullptr),
+        m_fullestPage(nullptr),
+        m_arena(nullptr)
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
         , m_StatReport{}
 #endif
@@ -15,59 +23,193 @@ namespace FixedSizeAllocator {
             destroy();
     }
 
-    void FixedSizeAllocator::init(uint32 blockSize) {
+    void FixedSizeAllocator::init(uint32 blockSize, PageArena::PageArena* arena, bool typeStable, ReusePolicy policy) {
         if (m_headPage != nullptr) {
             return;
         }
 
+        ASSERT(!typeStable || blockSize >= 2 * sizeof(Block));
+
+        m_arena = arena;
+        m_reusePolicy = policy;
         m_blockSize = blockSize;
+        m_linkOffset = typeStable ? (blockSize - (uint32)sizeof(Block)) & ~((uint32)sizeof(Block) - 1) : 0;
+        // Blocks of a power of two size are naturally aligned when they start at a
+        // multiple of blockSize from the page, the header fits into the skipped space
+        m_dataOffset = (blockSize & (blockSize - 1)) == 0 && blockSize <= MAX_NATURAL_ALIGNMENT
+            ? ((uint32)sizeof(Page) + blockSize - 1) & ~(blockSize - 1)
+            : sizeof(Page);
         m_headPage = createPage();
     }
 
     void FixedSizeAllocator::destroy() {
         ASSERT(m_headPage != nullptr);
 
-        uint32 pageNum = 0;
-        while (m_headPage) {
-            Page* next = m_headPage->next;
-
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+        uint32 pageNum = 0;
+        for (Page* page = m_headPage; page != nullptr; page = page->next) {
             AllocBlocksReport report = getAllocBlocksReport(pageNum++);
             ASSERT(report.count == 0);
+        }
 #endif
 
-            if (!VirtualFree(m_headPage, 0, MEM_RELEASE)) {
+        releasePages();
+    }
+
+    void* FixedSizeAllocator::alloc(uint32 size) {
+        bool zeroed;
+        return allocBlock(size, zeroed);
+    }
+
+    void* FixedSizeAllocator::allocZeroed(uint32 size) {
+        bool zeroed;
+        void* p = allocBlock(size, zeroed);
+
+        if (p != nullptr && !zeroed)
+            memset(p, 0, m_blockSize);
+
+        return p;
+    }
+
+    // Blocks past numInit were never handed out, so they still hold the zeroes of a fresh page
+    void* FixedSizeAllocator::allocBlock(uint32 size, bool& outZeroed) {
+        ASSERT(m_headPage != nullptr);
+
+        if (size > m_blockSize)
+            return nullptr;
+
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
-                printf("VirtualFree failed.\n");
+        m_StatReport.allocCallCount++;
 #endif
-                return;
+
+        Page* page = m_headPage;
+        if (m_reusePolicy == ReusePolicy::FullestPage) {
+            if (m_fullestPage == nullptr || m_fullestPage->numUsed == (int)PAGE_SIZE)
+                m_fullestPage = findFullestPage();
+
+            if (m_fullestPage != nullptr)
+                return takeBlock(m_fullestPage, outZeroed);
+
+            while (page->next != nullptr)
+                page = page->next;
+        }
+        else {
+            while (true) {
+                if (void* p = takeBlock(page, outZeroed))
+                    return p;
+
+                if (page->next == nullptr)
+                    break;
+
+                page = page->next;
             }
+        }
 
-            m_headPage = next;
+        Page* newPage = createPage();
+
+        if (newPage == nullptr)
+            return nullptr;
+
+        newPage->numInit = 1;
+        newPage->numUsed = 1;
+        page->next = newPage;
+        outZeroed = true;
+
+        if (m_reusePolicy == ReusePolicy::FullestPage)
+            m_fullestPage = newPage;
+
+        return (BYTE*)newPage + m_dataOffset;
+    }
+
+    // Lifo takes never used blocks first, the ordered policies the free list: its blocks sit
+    // below numInit, so the untouched tail of the page stays uncommitted in RSS
+    void* FixedSizeAllocator::takeBlock(Page* page, bool& outZeroed) const {
+        bool freeListFirst = m_reusePolicy != ReusePolicy::Lifo;
+
+        if (page->fh >= 0 && (freeListFirst || page->numInit == PAGE_SIZE)) {
+            outZeroed = false;
+            int fh = page->fh;
+            page->fh = getBlock(page, fh)->freeIndex;
+            page->numUsed++;
+            return (BYTE*)page + m_dataOffset + fh * m_blockSize;
+        }
+
+        if (page->numInit < PAGE_SIZE) {
+            page->numInit++;
+            page->numUsed++;
+            outZeroed = true;
+            return (BYTE*)page + m_dataOffset + (page->numInit - 1) * m_blockSize;
         }
+
+        return nullptr;
     }
 
-    void* FixedSizeAllocator::alloc(uint32 size) {
+    FixedSizeAllocator::Page *FixedSizeAllocator::findFullestPage() const {
+        Page* fullest = nullptr;
+        for (Page* page = m_headPage; page; page = page->next) {
+            if (page->numUsed < (int)PAGE_SIZE && (fullest == nullptr || page->numUsed > fullest->numUsed)) {
+                fullest = page;
+                if (page->numUsed == (int)PAGE_SIZE - 1)
+                    break;
+            }
+        }
+
+        return fullest;
+    }
+
+    // Candidates are the fresh block at numInit and the first NEAR_SCAN_LIMIT blocks of the
+    // free list, so the cost stays bounded while blocks freed near hint are usually found
+    void* FixedSizeAllocator::allocNear(uint32 size, const void* hint) {
         ASSERT(m_headPage != nullptr);
 
-        if (size > m_blockSize)
-            return nullptr;
+        Page* page = findPage(hint);
+        if (page == nullptr || page->numUsed == PAGE_SIZE || size > m_blockSize)
+            return alloc(size);
 
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
         m_StatReport.allocCallCount++;
 #endif
 
-        Page* page = m_headPage;
-        while (true) {
-            if (page->numInit < PAGE_SIZE) {
-                page->numInit++;
-                return (BYTE*)page + sizeof(Page) + (page->numInit - 1) * m_blockSize;
+        int hintIndex = (int)((const BYTE*)hint - (BYTE*)page - m_dataOffset) / (int)m_blockSize;
+        int best = page->numInit < PAGE_SIZE ? page->numInit : -1;
+        int* bestLink = nullptr;
+
+        int* link = &page->fh;
+        for (uint32 i = 0; i < NEAR_SCAN_LIMIT && *link >= 0; i++) {
+            if (best < 0 || abs(*link - hintIndex) < abs(best - hintIndex)) {
+                best = *link;
+                bestLink = link;
             }
+            link = &getBlock(page, *link)->freeIndex;
+        }
 
-            if (page->fh >= 0) {
-                int fh = page->fh;
-                page->fh = ((Block*)((BYTE*)page + sizeof(Page) + page->fh * m_blockSize))->freeIndex;
-                return (BYTE*)page + sizeof(Page) + fh * m_blockSize;
+        if (bestLink != nullptr)
+            *bestLink = getBlock(page, best)->freeIndex;
+        else
+            page->numInit++;
+
+        page->numUsed++;
+        return (BYTE*)page + m_dataOffset + best * m_blockSize;
+    }
+
+    // Free-list blocks are scattered over the page, so a run is only cut from the numInit region
+    void* FixedSizeAllocator::allocRun(uint32 count) {
+        ASSERT(m_headPage != nullptr);
+
+        if (count == 0 || count > PAGE_SIZE)
+            return nullptr;
+
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+        m_StatReport.allocCallCount += count;
+#endif
+
+        Page* page = m_headPage;
+        while (true) {
+            if (PAGE_SIZE - page->numInit >= count) {
+                void* p = (BYTE*)page + m_dataOffset + page->numInit * m_blockSize;
+                page->numInit += (int)count;
+                page->numUsed += (int)count;
+                return p;
             }
 
             if (page->next == nullptr)
@@ -81,10 +223,11 @@ namespace FixedSizeAllocator {
         if (newPage == nullptr)
             return nullptr;
 
-        newPage->numInit = 1;
+        newPage->numInit = (int)count;
+        newPage->numUsed = (int)count;
         page->next = newPage;
 
-        return (BYTE*)newPage + sizeof(Page);
+        return (BYTE*)newPage + m_dataOffset;
     }
 
     void FixedSizeAllocator::free(void *p) {
@@ -95,18 +238,31 @@ namespace FixedSizeAllocator {
 
         Page* page = m_headPage;
         while (true) {
-            int blockNum = (int)((BYTE*)p - (BYTE*)page - sizeof(Page)) / (int)m_blockSize;
+            if ((BYTE*)p >= (BYTE*)page + m_dataOffset && (BYTE*)p < (BYTE*)page + m_dataOffset + m_blockSize * PAGE_SIZE) {
+                int blockNum = (int)((BYTE*)p - (BYTE*)page - m_dataOffset) / (int)m_blockSize;
 
-            if (blockNum >= 0 && blockNum <= PAGE_SIZE) {
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
                 int fh = page->fh;
                 while (fh >= 0) {
                     ASSERT(blockNum != fh);
-                    fh = ((Block*)((BYTE*)page + sizeof(Page) + fh * m_blockSize))->freeIndex;
+                    fh = getBlock(page, fh)->freeIndex;
                 }
 #endif
-                ((Block*)((BYTE*)page + sizeof(Page) + blockNum * m_blockSize))->freeIndex = page->fh;
-                page->fh = blockNum;
+                // Ordered policies keep the free list sorted by index, so its head is the lowest address
+                int* link = &page->fh;
+                if (m_reusePolicy != ReusePolicy::Lifo) {
+                    while (*link >= 0 && *link < blockNum)
+                        link = &getBlock(page, *link)->freeIndex;
+                }
+
+                getBlock(page, blockNum)->freeIndex = *link;
+                *link = blockNum;
+                page->numUsed--;
+
+                // A page that was full may now be the fullest one with room
+                if (m_reusePolicy == ReusePolicy::FullestPage &&
+                    (m_fullestPage == nullptr || page->numUsed > m_fullestPage->numUsed))
+                    m_fullestPage = page;
                 return;
             }
 
@@ -115,26 +271,42 @@ namespace FixedSizeAllocator {
 
             page = page->next;
         }
+
+        ASSERT(false);
+    }
+
+    FixedSizeAllocator::Block* FixedSizeAllocator::getBlock(Page* page, int index) const {
+        return (Block*)((BYTE*)page + m_dataOffset + index * m_blockSize + m_linkOffset);
     }
 
     uint32 FixedSizeAllocator::getBlockSize() const {
         return m_blockSize;
     }
 
+    uint32 FixedSizeAllocator::getPageSize() const {
+        return m_dataOffset + m_blockSize * PAGE_SIZE;
+    }
+
     bool FixedSizeAllocator::containsAddress(void *p) const {
+        return findPage(p) != nullptr;
+    }
+
+    FixedSizeAllocator::Page *FixedSizeAllocator::findPage(const void* p) const {
         Page* page = m_headPage;
         while(page) {
-            if (p >= (BYTE*)page + sizeof(Page) && p < (BYTE*)page + sizeof(Page) + m_blockSize * PAGE_SIZE)
-                return true;
+            if (p >= (BYTE*)page + m_dataOffset && p < (BYTE*)page + m_dataOffset + m_blockSize * PAGE_SIZE)
+                return page;
 
             page = page->next;
         }
 
-        return false;
+        return nullptr;
     }
 
     FixedSizeAllocator::Page *FixedSizeAllocator::createPage() const {
-        Page* page = (Page*)VirtualAlloc(nullptr, sizeof(Page) + m_blockSize * PAGE_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        Page* page = m_arena != nullptr
+            ? (Page*)m_arena->allocPages(getPageSize())
+            : (Page*)VirtualAlloc(nullptr, getPageSize(), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
 
         if (page == nullptr) {
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
@@ -146,10 +318,80 @@ namespace FixedSizeAllocator {
         page->next = nullptr;
         page->numInit = 0;
         page->fh = -1;
+        page->numUsed = 0;
 
         return page;
     }
 
+    bool FixedSizeAllocator::releasePage(Page* page) const {
+        if (m_arena != nullptr) {
+            m_arena->freePages(page, getPageSize());
+        }
+        else if (!VirtualFree(page, 0, MEM_RELEASE)) {
+#if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
+            printf("VirtualFree failed.\n");
+#endif
+            return false;
+        }
+
+        return true;
+    }
+
+    bool FixedSizeAllocator::isTypeStable() const {
+        return m_linkOffset != 0;
+    }
+
+    ReusePolicy FixedSizeAllocator::getReusePolicy() const {
+        return m_reusePolicy;
+    }
+
+    // A type-stable page may still be read through stale pointers, so it is never released early
+    uint64 FixedSizeAllocator::trim() {
+        ASSERT(m_headPage != nullptr);
+
+        if (isTypeStable())
+            return 0;
+
+        // The cached page may be released
+        m_fullestPage = nullptr;
+
+        uint64 released = 0;
+        Page* prev = m_headPage;
+        while (Page* page = prev->next) {
+            if (page->numUsed == 0) {
+                prev->next = page->next;
+                if (releasePage(page))
+                    released += getPageSize();
+            }
+            else {
+                prev = page;
+            }
+        }
+
+        return released;
+    }
+
+    // The fresh page reads as zero, which allocZeroed relies on for never used blocks
+    void FixedSizeAllocator::releaseAll() {
+        ASSERT(m_headPage != nullptr);
+        ASSERT(!isTypeStable());
+
+        releasePages();
+        m_headPage = createPage();
+        ASSERT(m_headPage != nullptr);
+    }
+
+    // A page the OS does not take back is leaked, the others are still released
+    void FixedSizeAllocator::releasePages() {
+        while (m_headPage) {
+            Page* next = m_headPage->next;
+            releasePage(m_headPage);
+            m_headPage = next;
+        }
+
+        m_fullestPage = nullptr;
+    }
+
 #if !defined(NDEBUG) && defined(ALLOCATORS_DEBUG)
     StatReport FixedSizeAllocator::getStatReport() const {
         ASSERT(m_headPage != nullptr);
@@ -162,7 +404,7 @@ namespace FixedSizeAllocator {
             int fh = page->fh;
             while (fh >= 0) {
                 freeCount++;
-                fh = ((Block*)((BYTE*)page + sizeof(Page) + fh * m_blockSize))->freeIndex;
+                fh = getBlock(page, fh)->freeIndex;
             }
             freeCount += PAGE_SIZE - page->numInit;
 
@@ -193,13 +435,13 @@ namespace FixedSizeAllocator {
         int fh = page->fh;
         while (fh >= 0) {
             blocks[fh] = true;
-            fh = ((Block*)((BYTE*)page + sizeof(Page) + fh * m_blockSize))->freeIndex;
+            fh = getBlock(page, fh)->freeIndex;
         }
 
         AllocBlocksReport report{};
         for (int i = 0; i < page->numInit; ++i) {
             if (!blocks[i]) {
-                report.blocks[report.count++] = (BYTE*)page + sizeof(Page) + i * m_blockSize;
+                report.blocks[report.count++] = (BYTE*)page + m_dataOffset + i * m_blockSize;
             }
         }
 
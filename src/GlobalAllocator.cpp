@@ -0,0 +1,148 @@
+#include "GlobalAllocator.h"
+#include "Common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace GlobalAllocator {
+    using Allocator = CompositeMemoryAllocator::CompositeMemoryAllocator;
+
+    // Zero-initialized before any code runs, the allocator is placed here on first use
+    alignas(Allocator) static uint8 s_storage[sizeof(Allocator)];
+    static Allocator* s_allocator = nullptr;
+    // Statically initialized and never destroyed, so new and delete keep working while
+    // other translation units run their static constructors and destructors
+    static SRWLOCK s_lock = SRWLOCK_INIT;
+
+    class ScopedLock {
+    public:
+        ScopedLock() { AcquireSRWLockExclusive(&s_lock); }
+        ~ScopedLock() { ReleaseSRWLockExclusive(&s_lock); }
+
+        ScopedLock(const ScopedLock&) = delete;
+        ScopedLock& operator = (const ScopedLock&) = delete;
+    };
+
+    GlobalAllocator GlobalAllocator::instance;
+
+    // The caller holds s_lock
+    Allocator& GlobalAllocator::composite() {
+        if (s_allocator == nullptr) {
+            auto* allocator = new (s_storage) Allocator();
+            if (!allocator->initReserved())
+                allocator->init();
+            s_allocator = allocator;
+        }
+        return *s_allocator;
+    }
+
+    // Reserved and committed in one step, the block is never grown
+    void* GlobalAllocator::allocLarge(uint64 size) {
+        Allocator& allocator = composite();
+        void* p = allocator.allocGrowable(size);
+        if (p != nullptr && !allocator.grow(p, size)) {
+            allocator.free(p);
+            return nullptr;
+        }
+        return p;
+    }
+
+    void* GlobalAllocator::alloc(uint64 size) {
+        ScopedLock lock;
+        return size <= UINT32_MAX ? composite().alloc((uint32)size) : allocLarge(size);
+    }
+
+    void* GlobalAllocator::allocZeroed(uint64 size) {
+        ScopedLock lock;
+        // Freshly committed pages are zero
+        return size <= UINT32_MAX ? composite().allocZeroed((uint32)size) : allocLarge(size);
+    }
+
+    void* GlobalAllocator::allocNear(uint64 size, const void* hint) {
+        ScopedLock lock;
+        return size <= UINT32_MAX ? composite().allocNear((uint32)size, hint) : allocLarge(size);
+    }
+
+    void* GlobalAllocator::allocAligned(uint64 size, uint64 align) {
+        if (size > UINT32_MAX || align > (1u << 31))
+            return nullptr;
+
+        ScopedLock lock;
+        return composite().allocAligned((uint32)size, (uint32)align);
+    }
+
+    void GlobalAllocator::free(void* p) {
+        if (p == nullptr)
+            return;
+
+        ScopedLock lock;
+        composite().free(p);
+    }
+
+    void GlobalAllocator::free(void* p, uint64 size) {
+        if (p == nullptr)
+            return;
+
+        ScopedLock lock;
+        if (size <= UINT32_MAX)
+            composite().free(p, (uint32)size);
+        else
+            composite().free(p);
+    }
+
+    void GlobalAllocator::freeAligned(void* p, uint64 size, uint64 align) {
+        if (p == nullptr)
+            return;
+
+        ScopedLock lock;
+        composite().freeAligned(p, (uint32)size, (uint32)align);
+    }
+
+    void* GlobalAllocator::realloc(void* p, uint64 size) {
+        ScopedLock lock;
+        Allocator& allocator = composite();
+        if (size <= UINT32_MAX)
+            return allocator.realloc(p, (uint32)size);
+
+        void* np = allocLarge(size);
+        if (np != nullptr && p != nullptr) {
+            memcpy(np, p, std::min(allocator.usableSize(p), size));
+            allocator.free(p);
+        }
+        return np;
+    }
+
+    void* GlobalAllocator::allocGrowable(uint64 maxSize) {
+        ScopedLock lock;
+        return composite().allocGrowable(maxSize);
+    }
+
+    bool GlobalAllocator::grow(void* p, uint64 size) {
+        ScopedLock lock;
+        return composite().grow(p, size);
+    }
+
+    uint64 GlobalAllocator::usableSize(void* p) {
+        if (p == nullptr)
+            return 0;
+
+        ScopedLock lock;
+        return composite().usableSize(p);
+    }
+
+    uint64 GlobalAllocator::goodSize(uint64 size) {
+        ScopedLock lock;
+        return size <= UINT32_MAX ? composite().goodSize((uint32)size) : size;
+    }
+
+    bool GlobalAllocator::owns(void* p) {
+        ScopedLock lock;
+        return composite().owns(p);
+    }
+
+    uint64 GlobalAllocator::trim() {
+        ScopedLock lock;
+        return composite().trim();
+    }
+}
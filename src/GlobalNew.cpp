@@ -0,0 +1,78 @@
+#include "GlobalAllocator.h"
+
+#include <new>
+
+// Replaces every global operator new/delete with GlobalAllocator, so containers without
+// an allocator parameter use it too. Built as composite_memory_allocator_global_new, which an
+// executable links explicitly; it must be linked at most once per program.
+// Sized delete passes the size on, which selects the size class without an ownership search.
+namespace {
+    GlobalAllocator::GlobalAllocator& global = GlobalAllocator::GlobalAllocator::instance;
+
+    void* allocOrThrow(std::size_t size) {
+        while (true) {
+            if (void* p = global.alloc(size))
+                return p;
+
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+                throw std::bad_alloc{};
+            handler();
+        }
+    }
+
+    void* allocAlignedOrThrow(std::size_t size, std::align_val_t align) {
+        while (true) {
+            if (void* p = global.allocAligned(size, (std::size_t)align))
+                return p;
+
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+                throw std::bad_alloc{};
+            handler();
+        }
+    }
+
+    void* allocNoThrow(std::size_t size) noexcept {
+        try {
+            return allocOrThrow(size);
+        }
+        catch (...) {
+            return nullptr;
+        }
+    }
+
+    void* allocAlignedNoThrow(std::size_t size, std::align_val_t align) noexcept {
+        try {
+            return allocAlignedOrThrow(size, align);
+        }
+        catch (...) {
+            return nullptr;
+        }
+    }
+}
+
+void* operator new(std::size_t size) { return allocOrThrow(size); }
+void* operator new[](std::size_t size) { return allocOrThrow(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocNoThrow(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocNoThrow(size); }
+
+void* operator new(std::size_t size, std::align_val_t align) { return allocAlignedOrThrow(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return allocAlignedOrThrow(size, align); }
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return allocAlignedNoThrow(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return allocAlignedNoThrow(size, align); }
+
+void operator delete(void* p) noexcept { global.free(p); }
+void operator delete[](void* p) noexcept { global.free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { global.free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { global.free(p); }
+void operator delete(void* p, std::size_t size) noexcept { global.free(p, size); }
+void operator delete[](void* p, std::size_t size) noexcept { global.free(p, size); }
+
+// Unsized: the tier of an aligned block is still found from its address
+void operator delete(void* p, std::align_val_t) noexcept { global.free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { global.free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { global.free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { global.free(p); }
+void operator delete(void* p, std::size_t size, std::align_val_t align) noexcept { global.freeAligned(p, size, (std::size_t)align); }
+void operator delete[](void* p, std::size_t size, std::align_val_t align) noexcept { global.freeAligned(p, size, (std::size_t)align); }
@@ -0,0 +1,112 @@
+#include "HandleHeap.h"
+#include "Common.h"
+
+namespace HandleHeap {
+    // Entries are committed in steps of this many bytes
+    static constexpr uint32 TABLE_COMMIT_SIZE = 64u * 1024u;
+
+    HandleHeap::~HandleHeap() {
+        if (m_entries != nullptr)
+            destroy();
+    }
+
+    void HandleHeap::init() {
+        if (m_entries != nullptr)
+            return;
+
+        // The whole table is reserved once, so entries never move either
+        m_entries = (Entry*)VirtualAlloc(nullptr, (uint64)MAX_HANDLE_COUNT * sizeof(Entry), MEM_RESERVE, PAGE_NOACCESS);
+        ASSERT(m_entries != nullptr);
+        VirtualAlloc(m_entries, TABLE_COMMIT_SIZE, MEM_COMMIT, PAGE_READWRITE);
+
+        // Entry 0 stands for INVALID_HANDLE
+        m_entryCount = 1;
+        m_committedCount = TABLE_COMMIT_SIZE / sizeof(Entry);
+        m_freeHead = INVALID_HANDLE;
+        m_allocator.init();
+    }
+
+    void HandleHeap::destroy() {
+        ASSERT(m_entries != nullptr);
+
+        m_allocator.destroy();
+        VirtualFree(m_entries, 0, MEM_RELEASE);
+        m_entries = nullptr;
+    }
+
+    Handle HandleHeap::allocHandle(uint32 size) {
+        ASSERT(m_entries != nullptr);
+
+        auto* header = (BlockHeader*)m_allocator.alloc(sizeof(BlockHeader) + size);
+        if (header == nullptr)
+            return INVALID_HANDLE;
+
+        Handle handle = m_freeHead;
+        if (handle != INVALID_HANDLE) {
+            m_freeHead = m_entries[handle].nextFree;
+        }
+        else {
+            if (m_entryCount == m_committedCount) {
+                if (m_entryCount == MAX_HANDLE_COUNT ||
+                    VirtualAlloc((BYTE*)m_entries + (uint64)m_committedCount * sizeof(Entry), TABLE_COMMIT_SIZE, MEM_COMMIT, PAGE_READWRITE) == nullptr) {
+                    m_allocator.free(header);
+                    return INVALID_HANDLE;
+                }
+
+                m_committedCount += TABLE_COMMIT_SIZE / sizeof(Entry);
+            }
+
+            handle = m_entryCount++;
+        }
+
+        header->handle = handle;
+        m_entries[handle] = Entry{ header, 0, INVALID_HANDLE };
+        return handle;
+    }
+
+    void HandleHeap::freeHandle(Handle handle) {
+        ASSERT(handle != INVALID_HANDLE && handle < m_entryCount);
+
+        Entry& entry = m_entries[handle];
+        ASSERT(entry.block != nullptr && entry.pinCount == 0);
+
+        m_allocator.free(entry.block);
+        entry.block = nullptr;
+        entry.nextFree = m_freeHead;
+        m_freeHead = handle;
+    }
+
+    void* HandleHeap::pin(Handle handle) {
+        ASSERT(handle != INVALID_HANDLE && handle < m_entryCount);
+
+        Entry& entry = m_entries[handle];
+        ASSERT(entry.block != nullptr);
+
+        entry.pinCount++;
+        return (BYTE*)entry.block + sizeof(BlockHeader);
+    }
+
+    void HandleHeap::unpin(Handle handle) {
+        ASSERT(handle != INVALID_HANDLE && handle < m_entryCount);
+        ASSERT(m_entries[handle].pinCount > 0);
+
+        m_entries[handle].pinCount--;
+    }
+
+    CoalesceAllocator::CompactResult HandleHeap::compact(uint32 maxMoves) {
+        ASSERT(m_entries != nullptr);
+        return m_allocator.compact(maxMoves, canMove, moved, this);
+    }
+
+    bool HandleHeap::canMove(void* p, void* context) {
+        auto* heap = (HandleHeap*)context;
+        return heap->m_entries[((BlockHeader*)p)->handle].pinCount == 0;
+    }
+
+    void HandleHeap::moved(void* oldP, void* newP, void* context) {
+        auto* heap = (HandleHeap*)context;
+        Entry& entry = heap->m_entries[((BlockHeader*)newP)->handle];
+        ASSERT(entry.block == oldP);
+        entry.block = newP;
+    }
+}
@@ -0,0 +1,115 @@
+#include "LifetimeHeap.h"
+#include "Common.h"
+
+namespace LifetimeHeap {
+    // Open addressing gives up after this many slots, the site or sample is then not tracked
+    static constexpr uint32 MAX_PROBES = 8;
+
+    void LifetimeHeap::init() {
+        for (auto& allocator : m_allocators)
+            allocator.init();
+    }
+
+    void LifetimeHeap::destroy() {
+        for (auto& allocator : m_allocators)
+            allocator.destroy();
+    }
+
+    void* LifetimeHeap::alloc(uint32 size, Lifetime lifetime) {
+        m_tick++;
+        return m_allocators[(uint32)lifetime].alloc(size);
+    }
+
+    void* LifetimeHeap::allocAt(uint32 size, const void* site) {
+        Site* entry = findSite(site);
+        void* p = alloc(size, classify(entry));
+        if (p == nullptr || entry == nullptr || entry->allocCount++ % SAMPLE_PERIOD != 0)
+            return p;
+
+        uint32 slot = hash(p, SAMPLE_SLOT_COUNT);
+        for (uint32 i = 0; i < MAX_PROBES; i++, slot = (slot + 1) % SAMPLE_SLOT_COUNT) {
+            if (m_samples[slot].p == nullptr) {
+                m_samples[slot] = Sample{ p, entry, m_tick };
+                break;
+            }
+        }
+
+        return p;
+    }
+
+    void LifetimeHeap::free(void* p) {
+        if (p == nullptr)
+            return;
+
+        uint32 slot = hash(p, SAMPLE_SLOT_COUNT);
+        for (uint32 i = 0; i < MAX_PROBES; i++, slot = (slot + 1) % SAMPLE_SLOT_COUNT) {
+            Sample& sample = m_samples[slot];
+            if (sample.p != p)
+                continue;
+
+            // Moving average over the last ~8 samples, the first one seeds it
+            uint64 lifetime = m_tick - sample.birth;
+            Site* site = sample.site;
+            site->avgLifetime = site->samples == 0 ? lifetime : site->avgLifetime - site->avgLifetime / 8 + lifetime / 8;
+            site->samples++;
+            sample = Sample{};
+            break;
+        }
+
+        auto& shortLived = m_allocators[(uint32)Lifetime::Short];
+        if (shortLived.owns(p))
+            shortLived.free(p);
+        else
+            m_allocators[(uint32)Lifetime::Long].free(p);
+    }
+
+    Lifetime LifetimeHeap::predict(const void* site) const {
+        uint32 slot = hash(site, SITE_SLOT_COUNT);
+        for (uint32 i = 0; i < MAX_PROBES; i++, slot = (slot + 1) % SITE_SLOT_COUNT) {
+            const Site& entry = m_sites[slot];
+            if (entry.key == site)
+                return classify(&entry);
+
+            if (entry.key == nullptr)
+                break;
+        }
+
+        return Lifetime::Long;
+    }
+
+    uint64 LifetimeHeap::trim(Lifetime lifetime) {
+        return m_allocators[(uint32)lifetime].trim();
+    }
+
+    CompositeMemoryAllocator::CompositeMemoryAllocator& LifetimeHeap::allocator(Lifetime lifetime) {
+        return m_allocators[(uint32)lifetime];
+    }
+
+    LifetimeHeap::Site* LifetimeHeap::findSite(const void* site) {
+        uint32 slot = hash(site, SITE_SLOT_COUNT);
+        for (uint32 i = 0; i < MAX_PROBES; i++, slot = (slot + 1) % SITE_SLOT_COUNT) {
+            Site& entry = m_sites[slot];
+            if (entry.key == site)
+                return &entry;
+
+            if (entry.key == nullptr) {
+                entry.key = site;
+                return &entry;
+            }
+        }
+
+        return nullptr;
+    }
+
+    Lifetime LifetimeHeap::classify(const Site* site) {
+        if (site != nullptr && site->samples >= MIN_SAMPLES && site->avgLifetime < SHORT_LIFETIME)
+            return Lifetime::Short;
+
+        return Lifetime::Long;
+    }
+
+    uint32 LifetimeHeap::hash(const void* p, uint32 slotCount) {
+        // Fibonacci hashing, the low bits of block addresses are mostly zero
+        return (uint32)(((uint64)p * 0x9E3779B97F4A7C15ull) >> 40) % slotCount;
+    }
+}
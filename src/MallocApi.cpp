@@ -0,0 +1,56 @@
+#include "MallocApi.h"
+#include "GlobalAllocator.h"
+
+#include <cerrno>
+
+static GlobalAllocator::GlobalAllocator& global = GlobalAllocator::GlobalAllocator::instance;
+
+extern "C" {
+
+void* cma_malloc(size_t size) {
+    void* p = global.alloc(size);
+    if (p == nullptr)
+        errno = ENOMEM;
+    return p;
+}
+
+void cma_free(void* p) {
+    global.free(p);
+}
+
+void* cma_realloc(void* p, size_t size) {
+    void* np = global.realloc(p, size);
+    if (np == nullptr && size != 0)
+        errno = ENOMEM;
+    return np;
+}
+
+void* cma_calloc(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    void* p = global.allocZeroed(count * size);
+    if (p == nullptr)
+        errno = ENOMEM;
+    return p;
+}
+
+void* cma_memalign(size_t align, size_t size) {
+    if (align == 0 || (align & (align - 1)) != 0) {
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    void* p = global.allocAligned(size, align);
+    if (p == nullptr)
+        errno = ENOMEM;
+    return p;
+}
+
+size_t cma_malloc_usable_size(void* p) {
+    return global.usableSize(p);
+}
+
+}
@@ -0,0 +1,256 @@
+#include "PageArena.h"
+#include "Common.h"
+
+#include <algorithm>
+
+namespace PageArena {
+
+    void PageArena::init(void* base, uint64 capacity, bool commitOnDemand) {
+        ASSERT(((uint64)base & (PAGE_SIZE - 1)) == 0);
+
+        m_base = (uint8*)base;
+        m_capacity = capacity & ~(uint64)(PAGE_SIZE - 1);
+        m_top = 0;
+        m_used = 0;
+        m_zeroedHead = nullptr;
+        m_dirtyHead = nullptr;
+        m_spanHead = nullptr;
+        m_spanSize = 0;
+        m_commitOnDemand = commitOnDemand;
+    }
+
+    void PageArena::initGrowable(uint64 spanSize) {
+        ASSERT(spanSize > PAGE_SIZE);
+
+        init(nullptr, 0, true);
+        m_spanSize = (spanSize + SPAN_ALIGNMENT - 1) & ~(SPAN_ALIGNMENT - 1);
+    }
+
+    void PageArena::destroy() {
+        while (m_spanHead) {
+            Span* next = m_spanHead->next;
+            VirtualFree(m_spanHead, 0, MEM_RELEASE);
+            m_spanHead = next;
+        }
+
+        m_zeroedHead = nullptr;
+        m_dirtyHead = nullptr;
+        m_capacity = 0;
+        m_used = 0;
+    }
+
+    // The new span goes to the free list as one range, first fit then splits it like any other
+    bool PageArena::addSpan(uint64 minSize) {
+        uint64 size = std::max(m_spanSize, (minSize + PAGE_SIZE + SPAN_ALIGNMENT - 1) & ~(SPAN_ALIGNMENT - 1));
+
+        auto* span = (Span*)VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+        if (span == nullptr)
+            return false;
+
+        // The span header and the header of its free range
+        if (VirtualAlloc(span, 2 * PAGE_SIZE, MEM_COMMIT, PAGE_READWRITE) == nullptr) {
+            VirtualFree(span, 0, MEM_RELEASE);
+            return false;
+        }
+
+        span->next = m_spanHead;
+        span->size = size;
+        m_spanHead = span;
+        m_capacity += size;
+
+        insertFreeRange(m_zeroedHead, (FreeRange*)((uint8*)span + PAGE_SIZE), size - PAGE_SIZE);
+        return true;
+    }
+
+    void* PageArena::allocPages(uint64 size, bool commit) {
+        ASSERT(m_base != nullptr || isGrowable());
+        ASSERT(commit || m_commitOnDemand);
+
+        size = (size + PAGE_SIZE - 1) & ~(uint64)(PAGE_SIZE - 1);
+
+        // Callers expect the zeroes of fresh pages. Clearing a dirty run costs less than
+        // the decommit and commit it would take to get zero pages from the OS.
+        FreeRange* prev = nullptr;
+        if (commit) {
+            if (FreeRange* range = findFreeRange(m_dirtyHead, size, prev)) {
+                takeFreeRange(m_dirtyHead, prev, range, size);
+                memset(range, 0, size);
+                return range;
+            }
+        }
+
+        // The run and the header page of the rest are committed in one call
+        if (FreeRange* range = findFreeRange(m_zeroedHead, size, prev)) {
+            if (m_commitOnDemand) {
+                bool split = range->size > size;
+                uint8* start = commit ? (uint8*)range : (uint8*)range + size;
+                uint64 commitSize = (commit ? size : 0) + (split ? PAGE_SIZE : 0);
+                if (commitSize != 0 && VirtualAlloc(start, commitSize, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+                    return nullptr;
+            }
+
+            takeFreeRange(m_zeroedHead, prev, range, size);
+            memset(range, 0, sizeof(FreeRange));
+            return range;
+        }
+
+        if (isGrowable())
+            return addSpan(size) ? allocPages(size, commit) : nullptr;
+
+        // The part above m_top has never been handed out
+        if (m_top + size > m_capacity)
+            return nullptr;
+
+        uint8* p = m_base + m_top;
+        if (m_commitOnDemand && commit && VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+            return nullptr;
+
+        m_top += size;
+        m_used += size;
+        return p;
+    }
+
+    // A freed run stays committed until trim, so reusing it costs no system call
+    void PageArena::freePages(void* p, uint64 size, bool decommit) {
+        ASSERT(containsAddress(p));
+
+        size = (size + PAGE_SIZE - 1) & ~(uint64)(PAGE_SIZE - 1);
+        m_used -= size;
+
+        // The caller may not have committed the first page, it is committed again on its own
+        if (decommit && m_commitOnDemand) {
+            VirtualFree(p, size, MEM_DECOMMIT);
+            VirtualAlloc(p, sizeof(FreeRange), MEM_COMMIT, PAGE_READWRITE);
+            insertFreeRange(m_zeroedHead, (FreeRange*)p, size);
+        }
+        else {
+            insertFreeRange(m_dirtyHead, (FreeRange*)p, size);
+        }
+    }
+
+    uint64 PageArena::trim() {
+        // Mapped memory stays as it is
+        if (!m_commitOnDemand)
+            return 0;
+
+        uint64 released = 0;
+        while (FreeRange* range = m_dirtyHead) {
+            m_dirtyHead = range->next;
+            uint64 size = range->size;
+            released += decommitRange(range, size);
+            insertFreeRange(m_zeroedHead, range, size);
+        }
+
+        // The free pages of a span merge into one range, which then covers all of it
+        Span** link = &m_spanHead;
+        while (Span* span = *link) {
+            auto* body = (FreeRange*)((uint8*)span + PAGE_SIZE);
+            FreeRange* prev = nullptr;
+            FreeRange* range = m_zeroedHead;
+            while (range && range < body) {
+                prev = range;
+                range = range->next;
+            }
+
+            if (range != body || range->size != span->size - PAGE_SIZE) {
+                link = &span->next;
+                continue;
+            }
+
+            if (prev) prev->next = range->next;
+            else m_zeroedHead = range->next;
+
+            *link = span->next;
+            m_capacity -= span->size;
+            // The span header and the range header
+            released += 2 * PAGE_SIZE;
+            VirtualFree(span, 0, MEM_RELEASE);
+        }
+
+        return released;
+    }
+
+    PageArena::FreeRange* PageArena::findFreeRange(FreeRange* head, uint64 size, FreeRange*& outPrev) {
+        outPrev = nullptr;
+        for (FreeRange* range = head; range; outPrev = range, range = range->next) {
+            if (range->size >= size)
+                return range;
+        }
+
+        return nullptr;
+    }
+
+    // The rest of the range stays in the list, its header lands in memory of the same kind
+    void PageArena::takeFreeRange(FreeRange*& head, FreeRange* prev, FreeRange* range, uint64 size) {
+        FreeRange* next = range->next;
+        if (range->size > size) {
+            next = (FreeRange*)((uint8*)range + size);
+            next->next = range->next;
+            next->size = range->size - size;
+        }
+
+        if (prev) prev->next = next;
+        else head = next;
+
+        m_used += size;
+    }
+
+    // For a committed range: the first page stays committed for the header and is cleared like the rest
+    uint64 PageArena::decommitRange(FreeRange* range, uint64 size) {
+        if (size > PAGE_SIZE)
+            VirtualFree((uint8*)range + PAGE_SIZE, size - PAGE_SIZE, MEM_DECOMMIT);
+        memset(range, 0, PAGE_SIZE);
+
+        return size - PAGE_SIZE;
+    }
+
+    void PageArena::insertFreeRange(FreeRange*& head, FreeRange* range, uint64 size) {
+        range->size = size;
+
+        FreeRange* prev = nullptr;
+        FreeRange* next = head;
+        while (next && next < range) {
+            prev = next;
+            next = next->next;
+        }
+
+        // Headers of merged ranges are cleared so that a zeroed range reads as zero
+        if (next && (uint8*)range + range->size == (uint8*)next) {
+            range->size += next->size;
+            FreeRange* merged = next;
+            next = next->next;
+            memset(merged, 0, sizeof(FreeRange));
+        }
+        range->next = next;
+
+        if (prev && (uint8*)prev + prev->size == (uint8*)range) {
+            prev->size += range->size;
+            prev->next = range->next;
+            memset(range, 0, sizeof(FreeRange));
+        }
+        else if (prev) {
+            prev->next = range;
+        }
+        else {
+            head = range;
+        }
+    }
+
+    bool PageArena::containsAddress(const void* p) const {
+        for (Span* span = m_spanHead; span; span = span->next) {
+            if ((const uint8*)p >= (uint8*)span + PAGE_SIZE && (const uint8*)p < (uint8*)span + span->size)
+                return true;
+        }
+
+        return (const uint8*)p >= m_base && (const uint8*)p < m_base + m_top;
+    }
+
+    uint32 PageArena::getSpanCount() const {
+        uint32 count = 0;
+        for (Span* span = m_spanHead; span; span = span->next)
+            count++;
+
+        return count;
+    }
+
+}
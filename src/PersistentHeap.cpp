@@ -0,0 +1,132 @@
+#include "PersistentHeap.h"
+#include "Common.h"
+
+#include <new>
+
+namespace PersistentHeap {
+    static constexpr uint64 MAGIC = 0x5041454854534550ull;
+    static constexpr uint32 VERSION = 1;
+
+    // First pages of the mapping, the arena manages everything after them
+    struct Header {
+        uint64 magic;
+        uint32 version;
+        // Catches files written by a build with a different allocator layout
+        uint32 layout;
+        uint64 capacity;
+        void* base;
+        void* roots[ROOT_COUNT];
+        PageArena::PageArena arena;
+        alignas(CompositeMemoryAllocator::CompositeMemoryAllocator)
+        uint8 allocator[sizeof(CompositeMemoryAllocator::CompositeMemoryAllocator)];
+    };
+
+    static constexpr uint32 LAYOUT = sizeof(CompositeMemoryAllocator::CompositeMemoryAllocator) ^
+                                     (uint32)sizeof(PageArena::PageArena) << 16;
+    static constexpr uint64 HEADER_SIZE = (sizeof(Header) + PageArena::PAGE_SIZE - 1) &
+                                          ~(uint64)(PageArena::PAGE_SIZE - 1);
+
+    // A file that open created and extended is cut back to empty, an existing one is untouched
+    static void closeFile(HANDLE file, bool created) {
+        if (created) {
+            LARGE_INTEGER start{};
+            SetFilePointerEx(file, start, nullptr, FILE_BEGIN);
+            SetEndOfFile(file);
+        }
+        CloseHandle(file);
+    }
+
+    PersistentHeap::~PersistentHeap() {
+        if (m_header != nullptr)
+            close();
+    }
+
+    bool PersistentHeap::open(const char* path, uint64 capacity, void* base) {
+        ASSERT(m_header == nullptr);
+        ASSERT(capacity > HEADER_SIZE);
+
+        HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        // The mapping extends a smaller file to capacity, so an existing heap of another
+        // capacity is rejected before it is created
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart != 0 && (uint64)fileSize.QuadPart != capacity)) {
+            CloseHandle(file);
+            return false;
+        }
+        bool created = fileSize.QuadPart == 0;
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)(capacity >> 32), (DWORD)capacity, nullptr);
+        if (mapping == nullptr) {
+            closeFile(file, created);
+            return false;
+        }
+
+        // Pointers inside the file are only valid at the base it was created at
+        auto* header = (Header*)MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, capacity, base);
+        if (header == nullptr) {
+            CloseHandle(mapping);
+            closeFile(file, created);
+            return false;
+        }
+
+        m_attached = header->magic != 0;
+        if (!m_attached) {
+            // A new file reads as zeroes
+            header->version = VERSION;
+            header->layout = LAYOUT;
+            header->capacity = capacity;
+            header->base = base;
+            header->arena.init((uint8*)base + HEADER_SIZE, capacity - HEADER_SIZE, false);
+            auto* allocator = new (header->allocator) CompositeMemoryAllocator::CompositeMemoryAllocator();
+            allocator->init(&header->arena);
+            header->magic = MAGIC;
+        }
+        else if (header->magic != MAGIC || header->version != VERSION || header->layout != LAYOUT ||
+                 header->capacity != capacity || header->base != base) {
+            UnmapViewOfFile(header);
+            CloseHandle(mapping);
+            closeFile(file, created);
+            return false;
+        }
+
+        m_header = header;
+        m_file = file;
+        m_mapping = mapping;
+        return true;
+    }
+
+    void PersistentHeap::close() {
+        ASSERT(m_header != nullptr);
+
+        FlushViewOfFile(m_header, 0);
+        UnmapViewOfFile(m_header);
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+        m_header = nullptr;
+        m_mapping = nullptr;
+        m_file = nullptr;
+    }
+
+    bool PersistentHeap::flush() {
+        ASSERT(m_header != nullptr);
+        return FlushViewOfFile(m_header, 0);
+    }
+
+    CompositeMemoryAllocator::CompositeMemoryAllocator& PersistentHeap::allocator() const {
+        ASSERT(m_header != nullptr);
+        return *std::launder((CompositeMemoryAllocator::CompositeMemoryAllocator*)m_header->allocator);
+    }
+
+    void PersistentHeap::setRoot(uint32 index, void* p) {
+        ASSERT(m_header != nullptr && index < ROOT_COUNT);
+        m_header->roots[index] = p;
+    }
+
+    void* PersistentHeap::getRoot(uint32 index) const {
+        ASSERT(m_header != nullptr && index < ROOT_COUNT);
+        return m_header->roots[index];
+    }
+}
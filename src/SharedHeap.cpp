@@ -0,0 +1,166 @@
+#include "SharedHeap.h"
+#include "Common.h"
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+
+namespace SharedHeap {
+    static constexpr uint64 MAGIC = 0x5041454844524853ull;
+    static constexpr uint32 VERSION = 1;
+
+    // Header::state, a new section starts out pending
+    static constexpr uint32 STATE_PENDING = 0;
+    static constexpr uint32 STATE_READY = 1;
+    static constexpr uint32 STATE_FAILED = 2;
+
+    // First pages of the section, the arena manages everything after them
+    struct Header {
+        std::atomic<uint32> state;
+        std::atomic<uint32> locked;
+        uint64 magic;
+        uint32 version;
+        // Catches processes built with a different allocator layout
+        uint32 layout;
+        uint64 capacity;
+        void* base;
+        std::atomic<void*> roots[ROOT_COUNT];
+        PageArena::PageArena arena;
+        alignas(CompositeMemoryAllocator::CompositeMemoryAllocator)
+        uint8 allocator[sizeof(CompositeMemoryAllocator::CompositeMemoryAllocator)];
+    };
+
+    static_assert(std::atomic<uint32>::is_always_lock_free && std::atomic<void*>::is_always_lock_free,
+                  "Atomics in the section must not depend on process-local locks");
+
+    static constexpr uint32 LAYOUT = sizeof(CompositeMemoryAllocator::CompositeMemoryAllocator) ^
+                                     (uint32)sizeof(PageArena::PageArena) << 16;
+    static constexpr uint64 HEADER_SIZE = (sizeof(Header) + PageArena::PAGE_SIZE - 1) &
+                                          ~(uint64)(PageArena::PAGE_SIZE - 1);
+
+    static CompositeMemoryAllocator::CompositeMemoryAllocator& getAllocator(Header* header) {
+        return *std::launder((CompositeMemoryAllocator::CompositeMemoryAllocator*)header->allocator);
+    }
+
+    SharedHeap::~SharedHeap() {
+        if (m_header != nullptr)
+            close();
+    }
+
+    bool SharedHeap::open(const char* name, uint64 capacity, void* base, uint32 attachTimeoutMs) {
+        ASSERT(m_header == nullptr);
+        ASSERT(capacity > HEADER_SIZE);
+
+        HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                            (DWORD)(capacity >> 32), (DWORD)capacity, name);
+        if (mapping == nullptr)
+            return false;
+
+        bool created = GetLastError() != ERROR_ALREADY_EXISTS;
+
+        // Pointers inside the section are only valid at the creator's base
+        auto* header = (Header*)MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, capacity, base);
+        if (header == nullptr) {
+            // Processes that attached in the meantime must not wait for a setup that never comes
+            if (created) {
+                if (auto* anywhere = (Header*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Header))) {
+                    anywhere->state.store(STATE_FAILED, std::memory_order_release);
+                    UnmapViewOfFile(anywhere);
+                }
+            }
+            CloseHandle(mapping);
+            return false;
+        }
+
+        if (created) {
+            // A new section reads as zeroes
+            header->magic = MAGIC;
+            header->version = VERSION;
+            header->layout = LAYOUT;
+            header->capacity = capacity;
+            header->base = base;
+            header->arena.init((uint8*)base + HEADER_SIZE, capacity - HEADER_SIZE, false);
+            auto* allocator = new (header->allocator) CompositeMemoryAllocator::CompositeMemoryAllocator();
+            allocator->init(&header->arena);
+            header->state.store(STATE_READY, std::memory_order_release);
+        }
+        else {
+            // A creator that died before it finished never publishes a state
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(attachTimeoutMs);
+            uint32 state;
+            while ((state = header->state.load(std::memory_order_acquire)) == STATE_PENDING &&
+                   std::chrono::steady_clock::now() < deadline)
+                std::this_thread::yield();
+
+            if (state != STATE_READY || header->magic != MAGIC || header->version != VERSION || header->layout != LAYOUT ||
+                header->capacity != capacity || header->base != base) {
+                UnmapViewOfFile(header);
+                CloseHandle(mapping);
+                return false;
+            }
+        }
+
+        m_header = header;
+        m_mapping = mapping;
+        m_created = created;
+        return true;
+    }
+
+    void SharedHeap::close() {
+        ASSERT(m_header != nullptr);
+
+        UnmapViewOfFile(m_header);
+        CloseHandle(m_mapping);
+        m_header = nullptr;
+        m_mapping = nullptr;
+    }
+
+    void* SharedHeap::alloc(uint32 size) {
+        ASSERT(m_header != nullptr);
+
+        lock();
+        void* p = getAllocator(m_header).alloc(size);
+        unlock();
+        return p;
+    }
+
+    void SharedHeap::free(void* p) {
+        ASSERT(m_header != nullptr);
+
+        lock();
+        getAllocator(m_header).free(p);
+        unlock();
+    }
+
+    uint64 SharedHeap::toOffset(const void* p) const {
+        ASSERT(m_header != nullptr && m_header->arena.containsAddress(p));
+        return (const uint8*)p - (const uint8*)m_header;
+    }
+
+    void* SharedHeap::fromOffset(uint64 offset) const {
+        ASSERT(m_header != nullptr && offset < m_header->capacity);
+        return (uint8*)m_header + offset;
+    }
+
+    void SharedHeap::setRoot(uint32 index, void* p) {
+        ASSERT(m_header != nullptr && index < ROOT_COUNT);
+        m_header->roots[index].store(p, std::memory_order_release);
+    }
+
+    void* SharedHeap::getRoot(uint32 index) const {
+        ASSERT(m_header != nullptr && index < ROOT_COUNT);
+        return m_header->roots[index].load(std::memory_order_acquire);
+    }
+
+    void SharedHeap::lock() {
+        while (m_header->locked.exchange(1, std::memory_order_acquire) != 0) {
+            while (m_header->locked.load(std::memory_order_relaxed) != 0)
+                std::this_thread::yield();
+        }
+    }
+
+    void SharedHeap::unlock() {
+        m_header->locked.store(0, std::memory_order_release);
+    }
+}
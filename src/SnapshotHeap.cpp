@@ -0,0 +1,187 @@
+#include "SnapshotHeap.h"
+#include "Common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace SnapshotHeap {
+    // First pages of the section, the arena manages everything after them
+    struct Header {
+        void* roots[ROOT_COUNT];
+        PageArena::PageArena arena;
+        alignas(CompositeMemoryAllocator::CompositeMemoryAllocator)
+        uint8 allocator[sizeof(CompositeMemoryAllocator::CompositeMemoryAllocator)];
+    };
+
+    static constexpr uint64 HEADER_SIZE = (sizeof(Header) + PageArena::PAGE_SIZE - 1) &
+                                          ~(uint64)(PageArena::PAGE_SIZE - 1);
+
+    // The live heap is a view mapped into a placeholder reserved at the base, so no other
+    // mapping can take the base while takeSnapshot and releaseSnapshot swap the view
+    static bool mapLiveView(HANDLE mapping, void* base, uint64 capacity, ULONG protect) {
+        return MapViewOfFile3(mapping, GetCurrentProcess(), base, 0, capacity,
+                              MEM_REPLACE_PLACEHOLDER, protect, nullptr, 0) == base;
+    }
+
+    static void unmapLiveView(void* base) {
+        UnmapViewOfFile2(GetCurrentProcess(), base, MEM_PRESERVE_PLACEHOLDER);
+    }
+
+    SnapshotHeap::~SnapshotHeap() {
+        if (m_header != nullptr)
+            close();
+    }
+
+    bool SnapshotHeap::open(uint64 capacity, void* base) {
+        ASSERT(m_header == nullptr);
+        ASSERT(capacity > HEADER_SIZE);
+
+        HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                            (DWORD)(capacity >> 32), (DWORD)capacity, nullptr);
+        if (mapping == nullptr)
+            return false;
+
+        if (VirtualAlloc2(GetCurrentProcess(), base, capacity, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER,
+                          PAGE_NOACCESS, nullptr, 0) == nullptr) {
+            CloseHandle(mapping);
+            return false;
+        }
+
+        if (!mapLiveView(mapping, base, capacity, PAGE_READWRITE)) {
+            VirtualFree(base, 0, MEM_RELEASE);
+            CloseHandle(mapping);
+            return false;
+        }
+
+        auto* header = (Header*)base;
+
+        header->arena.init((uint8*)base + HEADER_SIZE, capacity - HEADER_SIZE, false);
+        auto* allocator = new (header->allocator) CompositeMemoryAllocator::CompositeMemoryAllocator();
+        allocator->init(&header->arena);
+
+        m_header = header;
+        m_mapping = mapping;
+        m_capacity = capacity;
+        return true;
+    }
+
+    void SnapshotHeap::close() {
+        ASSERT(m_header != nullptr);
+
+        if (m_snapshot != nullptr) {
+            UnmapViewOfFile(m_snapshot);
+            m_snapshot = nullptr;
+        }
+
+        UnmapViewOfFile(m_header);
+        CloseHandle(m_mapping);
+        m_header = nullptr;
+        m_mapping = nullptr;
+    }
+
+    CompositeMemoryAllocator::CompositeMemoryAllocator& SnapshotHeap::allocator() const {
+        ASSERT(m_header != nullptr);
+        return *std::launder((CompositeMemoryAllocator::CompositeMemoryAllocator*)m_header->allocator);
+    }
+
+    void SnapshotHeap::setRoot(uint32 index, void* p) {
+        ASSERT(m_header != nullptr && index < ROOT_COUNT);
+        m_header->roots[index] = p;
+    }
+
+    void* SnapshotHeap::getRoot(uint32 index) const {
+        ASSERT(m_header != nullptr && index < ROOT_COUNT);
+        return m_header->roots[index];
+    }
+
+    //          before                       after
+    // base:    shared view of section  ->  copy-on-write view of section (live heap)
+    // other:   -                       ->  shared view of section (snapshot)
+    bool SnapshotHeap::takeSnapshot() {
+        ASSERT(m_header != nullptr && m_snapshot == nullptr);
+
+        // Writable only so that releaseSnapshot can fold the live pages back into it
+        auto* snapshot = (uint8*)MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, m_capacity);
+        if (snapshot == nullptr)
+            return false;
+
+        void* base = m_header;
+        unmapLiveView(base);
+        if (!mapLiveView(m_mapping, base, m_capacity, PAGE_WRITECOPY)) {
+            UnmapViewOfFile(snapshot);
+            // Nothing was written in between, the shared view is the same heap
+            if (!mapLiveView(m_mapping, base, m_capacity, PAGE_READWRITE))
+                discard();
+            return false;
+        }
+
+        m_snapshot = snapshot;
+        return true;
+    }
+
+    bool SnapshotHeap::releaseSnapshot() {
+        ASSERT(m_header != nullptr && m_snapshot != nullptr);
+
+        // A written copy-on-write page turns PAGE_READWRITE, the others are still the section's own
+        auto* live = (uint8*)m_header;
+        uint8* end = live + getHandedOutSize();
+        for (uint8* page = live; page < end;) {
+            MEMORY_BASIC_INFORMATION info;
+            if (VirtualQuery(page, &info, sizeof(info)) == 0) {
+                memcpy(m_snapshot + (page - live), page, end - page);
+                break;
+            }
+
+            uint8* regionEnd = std::min((uint8*)info.BaseAddress + info.RegionSize, end);
+            if (info.Protect == PAGE_READWRITE)
+                memcpy(m_snapshot + (page - live), page, regionEnd - page);
+            page = regionEnd;
+        }
+
+        unmapLiveView(live);
+        if (!mapLiveView(m_mapping, live, m_capacity, PAGE_READWRITE)) {
+            // The section holds the live heap now, a copy-on-write view of it is that heap too
+            if (!mapLiveView(m_mapping, live, m_capacity, PAGE_WRITECOPY))
+                discard();
+            return false;
+        }
+
+        UnmapViewOfFile(m_snapshot);
+        m_snapshot = nullptr;
+        return true;
+    }
+
+    // Only the placeholder is left at the base
+    void SnapshotHeap::discard() {
+        if (m_snapshot != nullptr) {
+            UnmapViewOfFile(m_snapshot);
+            m_snapshot = nullptr;
+        }
+
+        VirtualFree(m_header, 0, MEM_RELEASE);
+        CloseHandle(m_mapping);
+        m_header = nullptr;
+        m_mapping = nullptr;
+    }
+
+    const void* SnapshotHeap::inSnapshot(const void* p) const {
+        ASSERT(m_snapshot != nullptr);
+
+        if (p == nullptr)
+            return nullptr;
+
+        auto offset = (uint64)((const uint8*)p - (const uint8*)m_header);
+        ASSERT(offset < m_capacity);
+        return m_snapshot + offset;
+    }
+
+    const void* SnapshotHeap::getSnapshotRoot(uint32 index) const {
+        ASSERT(m_snapshot != nullptr && index < ROOT_COUNT);
+        return inSnapshot(((const Header*)m_snapshot)->roots[index]);
+    }
+
+    uint64 SnapshotHeap::getHandedOutSize() const {
+        return HEADER_SIZE + m_header->arena.getHighWaterMark();
+    }
+}
@@ -0,0 +1,229 @@
+#include "SubHeap.h"
+#include "Common.h"
+
+#include <cstring>
+
+namespace SubHeap {
+    void* SubHeap::alloc(uint32 size) {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        if (!admit(m_allocator.goodSize(size)))
+            return nullptr;
+
+        void* p = m_allocator.alloc(size);
+        if (p != nullptr)
+            charge(m_allocator.usableSize(p, size));
+        return p;
+    }
+
+    void* SubHeap::allocZeroed(uint32 size) {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        if (!admit(m_allocator.goodSize(size)))
+            return nullptr;
+
+        void* p = m_allocator.allocZeroed(size);
+        if (p != nullptr)
+            charge(m_allocator.usableSize(p, size));
+        return p;
+    }
+
+    void* SubHeap::allocNear(uint32 size, const void* hint) {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        if (!admit(m_allocator.goodSize(size)))
+            return nullptr;
+
+        void* p = m_allocator.allocNear(size, hint);
+        if (p != nullptr)
+            charge(m_allocator.usableSize(p, size));
+        return p;
+    }
+
+    // The tier of an over-aligned block does not follow from its size, it is searched for
+    void* SubHeap::allocAligned(uint32 size, uint32 align) {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        if (!admit(m_allocator.goodSizeAligned(size, align)))
+            return nullptr;
+
+        void* p = m_allocator.allocAligned(size, align);
+        if (p != nullptr)
+            charge(m_allocator.usableSize(p));
+        return p;
+    }
+
+    void SubHeap::free(void* p) {
+        if (p == nullptr)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        credit(m_allocator.usableSize(p));
+        m_allocator.free(p);
+    }
+
+    void SubHeap::free(void* p, uint32 size) {
+        if (p == nullptr)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        credit(m_allocator.usableSize(p, size));
+        m_allocator.free(p, size);
+    }
+
+    void SubHeap::freeAligned(void* p, uint32 size, uint32 align) {
+        if (p == nullptr)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        credit(m_allocator.usableSize(p));
+        m_allocator.freeAligned(p, size, align);
+    }
+
+    void* SubHeap::realloc(void* p, uint32 size) {
+        if (p == nullptr)
+            return alloc(size);
+
+        if (size == 0) {
+            free(p);
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        uint64 oldSize = m_allocator.usableSize(p);
+        uint64 newSize = m_allocator.goodSize(size);
+        if (newSize > oldSize && !admit(newSize - oldSize))
+            return nullptr;
+
+        void* np = m_allocator.realloc(p, size);
+        if (np != nullptr) {
+            credit(oldSize);
+            charge(m_allocator.usableSize(np));
+        }
+        return np;
+    }
+
+    uint64 SubHeap::usableSize(void* p) {
+        if (p == nullptr)
+            return 0;
+
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        return m_allocator.usableSize(p);
+    }
+
+    uint64 SubHeap::goodSize(uint32 size) {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        return m_allocator.goodSize(size);
+    }
+
+    bool SubHeap::owns(void* p) {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        return m_allocator.owns(p);
+    }
+
+    // The shared page heap decommits what this and every other sub-heap gave back
+    uint64 SubHeap::trim() {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        uint64 released = m_allocator.trim();
+        m_set->m_pageHeap.trim();
+        return released;
+    }
+
+    void SubHeap::releaseAll() {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        m_allocator.releaseAll();
+        m_stat.liveSize = 0;
+        m_stat.releaseAllCount++;
+    }
+
+    void SubHeap::setBudget(uint64 budget) {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        m_budget = budget;
+    }
+
+    uint64 SubHeap::getBudget() const {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        return m_budget;
+    }
+
+    StatReport SubHeap::getStat() const {
+        std::lock_guard<std::mutex> lock(m_set->m_lock);
+        return m_stat;
+    }
+
+    bool SubHeap::admit(uint64 size) {
+        if (m_budget == UNLIMITED || m_stat.liveSize + size <= m_budget)
+            return true;
+
+        m_stat.overBudgetCount++;
+        return false;
+    }
+
+    void SubHeap::charge(uint64 size) {
+        m_stat.allocCallCount++;
+        m_stat.liveSize += size;
+        if (m_stat.liveSize > m_stat.peakSize)
+            m_stat.peakSize = m_stat.liveSize;
+    }
+
+    void SubHeap::credit(uint64 size) {
+        ASSERT(m_stat.liveSize >= size);
+        m_stat.freeCallCount++;
+        m_stat.liveSize -= size;
+    }
+
+    void SubHeapSet::init() {
+        m_pageHeap.initGrowable();
+    }
+
+    // Every block is released with its pages, so destroy finds the tiers empty
+    void SubHeapSet::destroy() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (uint32 i = 0; i < m_count; ++i) {
+            SubHeap& heap = m_heaps[i];
+            heap.m_allocator.releaseAll();
+            heap.m_allocator.destroy();
+            heap.m_set = nullptr;
+            heap.m_budget = UNLIMITED;
+            heap.m_stat = {};
+            memset(heap.m_name, 0, sizeof(heap.m_name));
+        }
+
+        m_count = 0;
+        m_pageHeap.destroy();
+    }
+
+    SubHeap* SubHeapSet::create(const char* name, uint64 budget) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_count == MAX_SUB_HEAPS || strlen(name) > MAX_NAME_LENGTH)
+            return nullptr;
+
+        for (uint32 i = 0; i < m_count; ++i) {
+            if (strcmp(m_heaps[i].m_name, name) == 0)
+                return nullptr;
+        }
+
+        SubHeap& heap = m_heaps[m_count++];
+        heap.m_allocator.init(&m_pageHeap);
+        heap.m_set = this;
+        heap.m_budget = budget;
+        strcpy(heap.m_name, name);
+        return &heap;
+    }
+
+    // Sub-heaps are only added until destroy, a found one stays valid
+    SubHeap* SubHeapSet::find(const char* name) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (uint32 i = 0; i < m_count; ++i) {
+            if (strcmp(m_heaps[i].m_name, name) == 0)
+                return &m_heaps[i];
+        }
+        return nullptr;
+    }
+
+    uint64 SubHeapSet::getCapacity() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_pageHeap.getCapacity();
+    }
+
+    uint64 SubHeapSet::getUsedSize() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_pageHeap.getUsedSize();
+    }
+}
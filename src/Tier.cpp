@@ -0,0 +1,133 @@
+#include "Tier.h"
+#include "Common.h"
+
+namespace Tier {
+    static constexpr uint64 VIRTUAL_PAGE_SIZE = 4096u;
+
+    void FixedSizeTier::init(uint32 blockSize, PageArena::PageArena* arena, FixedSizeAllocator::ReusePolicy policy) {
+        m_allocator.init(blockSize, arena, false, policy);
+        m_stat = {};
+    }
+
+    void FixedSizeTier::destroy() {
+        m_allocator.destroy();
+    }
+
+    void* FixedSizeTier::alloc(uint32 size) {
+        void* p = m_allocator.alloc(size);
+        if (p != nullptr) {
+            m_stat.allocCallCount++;
+            m_stat.liveSize += m_allocator.getBlockSize();
+        }
+        return p;
+    }
+
+    void FixedSizeTier::free(void* p) {
+        m_allocator.free(p);
+        m_stat.freeCallCount++;
+        m_stat.liveSize -= m_allocator.getBlockSize();
+    }
+
+    bool FixedSizeTier::owns(const void* p) const {
+        return m_allocator.containsAddress((void*)p);
+    }
+
+    uint64 FixedSizeTier::usableSize(const void*) const {
+        return m_allocator.getBlockSize();
+    }
+
+    uint64 FixedSizeTier::trim() {
+        return m_allocator.trim();
+    }
+
+    void CoalesceTier::init(PageArena::PageArena* arena) {
+        m_allocator.init(arena);
+        m_stat = {};
+    }
+
+    void CoalesceTier::destroy() {
+        m_allocator.destroy();
+    }
+
+    void* CoalesceTier::alloc(uint32 size) {
+        void* p = m_allocator.alloc(size);
+        if (p != nullptr) {
+            m_stat.allocCallCount++;
+            m_stat.liveSize += CoalesceAllocator::CoalesceAllocator::getAllocSize(p);
+        }
+        return p;
+    }
+
+    void CoalesceTier::free(void* p) {
+        m_stat.freeCallCount++;
+        m_stat.liveSize -= CoalesceAllocator::CoalesceAllocator::getAllocSize(p);
+        m_allocator.free(p);
+    }
+
+    bool CoalesceTier::owns(const void* p) const {
+        return m_allocator.containsAddress((void*)p);
+    }
+
+    uint64 CoalesceTier::usableSize(const void* p) const {
+        return CoalesceAllocator::CoalesceAllocator::getAllocSize((void*)p);
+    }
+
+    uint64 CoalesceTier::trim() {
+        return m_allocator.trim();
+    }
+
+    VirtualTier::~VirtualTier() {
+        ASSERT(m_head == nullptr);
+    }
+
+    // [Block][.....size, rounded up to whole pages.....]
+    void* VirtualTier::alloc(uint32 size) {
+        uint64 reserved = (sizeof(Block) + (uint64)size + VIRTUAL_PAGE_SIZE - 1) & ~(VIRTUAL_PAGE_SIZE - 1);
+        auto* block = (Block*)VirtualAlloc(nullptr, reserved, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (block == nullptr)
+            return nullptr;
+
+        block->size = reserved - sizeof(Block);
+        block->next = m_head;
+        block->prev = nullptr;
+        if (m_head) m_head->prev = block;
+        m_head = block;
+
+        m_stat.allocCallCount++;
+        m_stat.liveSize += block->size;
+        return block + 1;
+    }
+
+    void VirtualTier::free(void* p) {
+        Block* block = findBlock(p);
+        if (block == nullptr) {
+            ASSERT(false);
+            return;
+        }
+
+        if (block->next) block->next->prev = block->prev;
+        if (block->prev) block->prev->next = block->next;
+        else m_head = block->next;
+
+        m_stat.freeCallCount++;
+        m_stat.liveSize -= block->size;
+        VirtualFree(block, 0, MEM_RELEASE);
+    }
+
+    bool VirtualTier::owns(const void* p) const {
+        return findBlock(p) != nullptr;
+    }
+
+    uint64 VirtualTier::usableSize(const void* p) const {
+        Block* block = findBlock(p);
+        return block != nullptr ? block->size : 0;
+    }
+
+    VirtualTier::Block* VirtualTier::findBlock(const void* p) const {
+        for (Block* block = m_head; block != nullptr; block = block->next) {
+            if (block + 1 == p)
+                return block;
+        }
+        return nullptr;
+    }
+}
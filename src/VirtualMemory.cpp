@@ -0,0 +1,22 @@
+#include "VirtualMemory.h"
+#include "Common.h"
+
+namespace VirtualMemory {
+
+    void* reserve(uint64 size) {
+        return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+    }
+
+    bool commit(void* p, uint64 size) {
+        return VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+    }
+
+    void decommit(void* p, uint64 size) {
+        VirtualFree(p, size, MEM_DECOMMIT);
+    }
+
+    void release(void* p) {
+        VirtualFree(p, 0, MEM_RELEASE);
+    }
+
+}